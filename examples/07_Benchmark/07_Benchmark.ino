@@ -0,0 +1,201 @@
+/*
+  Benchmark the library against a simulated SARA-R410M
+  By: SparkFun Electronics
+  Date: October 16, 2026
+  License: This code is public domain but you buy me a beer if you use this
+  and we meet someday (Beerware license).
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/14997
+
+  This example runs the library against LTE_Shield_Simulator, a Stream
+  that answers AT commands like the SARA-R410M does, and prints how fast
+  socket writes, socket reads, poll() and GPS RMC parsing go. No shield
+  is needed, so numbers can be compared before and after a library change
+  on the same board. Socket writes and reads are run in both text and hex
+  data mode (setSocketDataMode()), and writes again over a direct link.
+  Small writes are run with and without a write buffer
+  (setSocketWriteBuffer()) to show what coalescing them saves.
+
+  SIM_LATENCY and SIM_BYTE_RATE set how slow the simulated modem is. With
+  both at 0 the results show the library's own overhead. Hex mode sends
+  twice the bytes but skips the '@' prompt, so it pulls ahead as
+  SIM_LATENCY goes up.
+
+  Open the serial monitor at 9600 baud to see the results.
+*/
+
+//Click here to get the library: http://librarymanager/All#SparkFun_LTE_Shield_Arduino_Library
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Simulator.h>
+
+// Milliseconds from a command to its response, and modem-to-Arduino bytes/s (0 = unlimited)
+#define SIM_LATENCY 0
+#define SIM_BYTE_RATE 0
+
+#define BENCH_ITERATIONS 50
+#define BENCH_PAYLOAD 64
+#define BENCH_RECORD 16 // Small writes for the write buffer run
+
+LTE_Shield_Simulator sim;
+LTE_Shield lte;
+
+unsigned long bytesReceived = 0;
+
+void processSocketData(int socket, const uint8_t *data, size_t length) {
+  bytesReceived += length;
+}
+
+void printResult(const __FlashStringHelper *name, unsigned long elapsed, unsigned long ops,
+                 unsigned long bytes) {
+  Serial.print(name);
+  Serial.print(F(": "));
+  Serial.print((float)elapsed / ops);
+  Serial.print(F(" us/op"));
+  if (elapsed > 0) {
+    Serial.print(F(", "));
+    Serial.print(ops * 1000000.0 / elapsed);
+    Serial.print(F(" ops/s"));
+    if (bytes > 0) {
+      Serial.print(F(", "));
+      Serial.print(bytes * 1000000.0 / elapsed);
+      Serial.print(F(" bytes/s"));
+    }
+  }
+  Serial.println();
+}
+
+void benchmarkSocket(int socket, lte_shield_data_mode_t mode, const char *payload) {
+  unsigned long start;
+  unsigned long bytesOut = sim.bytesFromHost();
+
+  lte.setSocketDataMode(mode);
+  bytesReceived = 0;
+
+  // Socket writes: in text mode a +USOWR command, '@' prompt and payload,
+  // in hex mode the payload goes on the command line as hex digits
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    lte.socketWrite(socket, payload);
+  }
+  printResult((mode == LTE_SHIELD_DATA_MODE_HEX) ? F("socketWrite (hex)") : F("socketWrite (text)"),
+              micros() - start, BENCH_ITERATIONS, (unsigned long)BENCH_ITERATIONS * BENCH_PAYLOAD);
+  Serial.print(F("  UART bytes sent: "));
+  Serial.println(sim.bytesFromHost() - bytesOut);
+
+  // Received data, announced with +UUSORD and read by poll()
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    sim.receiveSocketData(socket, BENCH_PAYLOAD);
+    while (bytesReceived < (unsigned long)(i + 1) * BENCH_PAYLOAD) {
+      lte.poll();
+    }
+  }
+  printResult((mode == LTE_SHIELD_DATA_MODE_HEX) ? F("socketRead (hex)") : F("socketRead (text)"),
+              micros() - start, BENCH_ITERATIONS, bytesReceived);
+}
+
+void setup() {
+  char payload[BENCH_PAYLOAD + 1];
+  PositionData pos;
+  SpeedData spd;
+  ClockData clk;
+  boolean valid;
+  unsigned long start;
+  int socket;
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+  static uint8_t writeBuffer[256];
+  struct SocketWriteStats writeStats;
+#endif
+
+  Serial.begin(9600);
+
+  sim.setLatency(SIM_LATENCY);
+  sim.setByteRate(SIM_BYTE_RATE);
+
+  start = micros();
+  if (!lte.begin(sim)) {
+    Serial.println(F("Simulator didn't answer, check the library"));
+    while (1) ;
+  }
+  Serial.print(F("init: "));
+  Serial.print(micros() - start);
+  Serial.print(F(" us, "));
+  Serial.print(lte.initStats().roundTrips);
+  Serial.println(F(" round trips"));
+
+  lte.setSocketDataCallback(&processSocketData);
+  socket = lte.socketOpen(LTE_SHIELD_TCP);
+
+  memset(payload, 'x', BENCH_PAYLOAD);
+  payload[BENCH_PAYLOAD] = '\0';
+
+  benchmarkSocket(socket, LTE_SHIELD_DATA_MODE_TEXT, payload);
+  benchmarkSocket(socket, LTE_SHIELD_DATA_MODE_HEX, payload);
+  lte.setSocketDataMode(LTE_SHIELD_DATA_MODE_TEXT);
+
+  // Small records, one +USOWR each, then collected in a write buffer and sent in batches
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    lte.socketWrite(socket, (const uint8_t *)payload, BENCH_RECORD);
+  }
+  printResult(F("socketWrite (small)"), micros() - start, BENCH_ITERATIONS,
+              (unsigned long)BENCH_ITERATIONS * BENCH_RECORD);
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+  lte.setSocketWriteBuffer(socket, writeBuffer, sizeof(writeBuffer));
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    lte.socketWrite(socket, (const uint8_t *)payload, BENCH_RECORD);
+  }
+  lte.socketFlush(socket);
+  printResult(F("socketWrite (buffered)"), micros() - start, BENCH_ITERATIONS,
+              (unsigned long)BENCH_ITERATIONS * BENCH_RECORD);
+  writeStats = lte.socketWriteStats(socket);
+  Serial.print(F("  flushes: "));
+  Serial.print(writeStats.flushes);
+  Serial.print(F(", average batch: "));
+  Serial.println(writeStats.averageBatch);
+  lte.setSocketWriteBuffer(socket, NULL, 0);
+#endif
+
+  // Direct link, the UART as a raw pipe to the socket with no AT framing
+  if (lte.directLinkBegin(socket) == LTE_SHIELD_ERROR_SUCCESS) {
+    start = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+      lte.directLinkWrite((const uint8_t *)payload, BENCH_PAYLOAD);
+    }
+    printResult(F("directLinkWrite"), micros() - start, BENCH_ITERATIONS,
+                (unsigned long)BENCH_ITERATIONS * BENCH_PAYLOAD);
+    start = millis();
+    lte.directLinkEnd();
+    Serial.print(F("  escape: "));
+    Serial.print(millis() - start);
+    Serial.println(F(" ms"));
+  }
+
+  // poll() with nothing to do
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS * 20; i++) {
+    lte.poll();
+  }
+  printResult(F("poll (idle)"), micros() - start, BENCH_ITERATIONS * 20, 0);
+
+  // AT+UGRMC? and the $GPRMC parser
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    lte.gpsGetRmc(&pos, &spd, &clk, &valid);
+  }
+  printResult(F("gpsGetRmc"), micros() - start, BENCH_ITERATIONS, 0);
+
+  lte.socketClose(socket);
+
+  Serial.print(F("Simulator: "));
+  Serial.print(sim.commandsHandled());
+  Serial.print(F(" commands, "));
+  Serial.print(sim.bytesFromHost());
+  Serial.print(F(" bytes in, "));
+  Serial.print(sim.bytesToHost());
+  Serial.println(F(" bytes out"));
+}
+
+void loop() {
+}
@@ -0,0 +1,74 @@
+/*
+  Fetch a web page through LTE_ShieldClient
+  By: SparkFun Electronics
+  Date: October 16, 2026
+  License: This code is public domain but you buy me a beer if you use this
+  and we meet someday (Beerware license).
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/14997
+
+  This example demonstrates LTE_ShieldClient, an Arduino Client on top of
+  the shield's sockets. Anything written for a Client (an MQTT or HTTP
+  library, say) can be handed one of these instead of an EthernetClient or
+  WiFiClient. Here it sends a plain HTTP GET and prints the reply.
+
+  Before beginning, you should have your shield connected on a MNO.
+  See example 00 for help with that.
+
+  Once programmed, open the serial monitor, set the baud rate to 9600.
+
+  Hardware Connections:
+  Attach the SparkFun LTE Cat M1/NB-IoT Shield to your Arduino
+  Power the shield with your Arduino -- ensure the PWR_SEL switch is in
+    the "ARDUINO" position.
+*/
+
+//Click here to get the library: http://librarymanager/All#SparkFun_LTE_Shield_Arduino_Library
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Client.h>
+
+// Create a SoftwareSerial object to pass to the LTE_Shield library
+SoftwareSerial lteSerial(8, 9);
+// Create a LTE_Shield object to use throughout the sketch
+LTE_Shield lte;
+// And a Client that uses it
+LTE_ShieldClient client(lte);
+
+const char HOST[] = "example.com";
+const unsigned int PORT = 80;
+
+void setup() {
+  Serial.begin(9600);
+
+  if ( lte.begin(lteSerial, 9600) ) {
+    Serial.println(F("LTE Shield connected!"));
+  }
+
+  if (client.connect(HOST, PORT)) {
+    Serial.println(F("Connected, sending request"));
+    client.print(F("GET / HTTP/1.0\r\nHost: "));
+    client.print(HOST);
+    client.print(F("\r\nConnection: close\r\n\r\n"));
+  } else {
+    Serial.println(F("Unable to connect"));
+  }
+}
+
+void loop() {
+  uint8_t buf[64];
+  int length;
+
+  // Bulk reads go straight from the module into buf, one AT command per call
+  if (client.available()) {
+    length = client.read(buf, sizeof(buf));
+    if (length > 0) {
+      Serial.write(buf, length);
+    }
+  }
+
+  if (!client.connected() && client) {
+    Serial.println();
+    Serial.println(F("Server closed the connection"));
+    client.stop();
+  }
+}
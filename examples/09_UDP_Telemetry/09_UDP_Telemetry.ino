@@ -0,0 +1,111 @@
+/*
+  Send telemetry over UDP and print whatever comes back
+  By: SparkFun Electronics
+  Date: October 16, 2026
+  License: This code is public domain but you buy me a beer if you use this
+  and we meet someday (Beerware license).
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/14997
+
+  This example demonstrates UDP datagrams with socketSendTo() and the
+  +UUSORF receive callback. UDP has no connection to set up or keep alive,
+  which makes it much cheaper than TCP for small periodic reports. Every
+  ten seconds a reading is sent to SERVER_IP, and every minute a burst of
+  queued readings goes out back to back with socketSendToBurst().
+
+  Before beginning, you should have your shield connected on a MNO.
+  See example 00 for help with that.
+
+  Once programmed, open the serial monitor, set the baud rate to 9600.
+
+  Hardware Connections:
+  Attach the SparkFun LTE Cat M1/NB-IoT Shield to your Arduino
+  Power the shield with your Arduino -- ensure the PWR_SEL switch is in
+    the "ARDUINO" position.
+*/
+
+//Click here to get the library: http://librarymanager/All#SparkFun_LTE_Shield_Arduino_Library
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+
+// Create a SoftwareSerial object to pass to the LTE_Shield library
+SoftwareSerial lteSerial(8, 9);
+// Create a LTE_Shield object to use throughout the sketch
+LTE_Shield lte;
+
+// Where to send readings -- an IP address, +USOST doesn't take host names
+const char SERVER_IP[] = "192.0.2.1";
+const unsigned int SERVER_PORT = 16666;
+
+#define READING_SIZE 8
+#define READINGS_PER_BURST 6
+
+int udpSocket = -1;
+// Replies of up to 128 bytes arrive whole, longer ones are cut short
+uint8_t datagramBuffer[129];
+uint8_t readings[READING_SIZE * READINGS_PER_BURST];
+int readingCount = 0;
+unsigned long lastReading = 0;
+
+void processDatagram(int socket, const uint8_t *data, size_t length, IPAddress remoteIP, unsigned int remotePort) {
+  Serial.print(F("Datagram from "));
+  Serial.print(remoteIP);
+  Serial.print(':');
+  Serial.print(remotePort);
+  Serial.print(F(": "));
+  Serial.write(data, length);
+  Serial.println();
+}
+
+void takeReading(uint8_t *reading) {
+  unsigned long now = millis();
+  int light = analogRead(A0);
+
+  memcpy(reading, &now, 4);
+  memcpy(reading + 4, &light, 2);
+  reading[6] = 0;
+  reading[7] = 0;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  if ( lte.begin(lteSerial, 9600) ) {
+    Serial.println(F("LTE Shield connected!"));
+  }
+
+  lte.setSocketRecvFromCallback(&processDatagram);
+  lte.setSocketRecvFromBuffer(datagramBuffer, sizeof(datagramBuffer));
+  udpSocket = lte.socketOpen(LTE_SHIELD_UDP);
+  if (udpSocket < 0) {
+    Serial.println(F("Unable to open a UDP socket"));
+  }
+}
+
+void loop() {
+  uint8_t reading[READING_SIZE];
+  int sent;
+
+  lte.poll();
+
+  if ((udpSocket < 0) || (millis() - lastReading < 10000)) {
+    return;
+  }
+  lastReading = millis();
+
+  // One reading on its own, right away
+  takeReading(reading);
+  sent = lte.socketSendTo(udpSocket, SERVER_IP, SERVER_PORT, reading, READING_SIZE);
+  Serial.print(F("Sent "));
+  Serial.print(sent);
+  Serial.println(F(" bytes"));
+
+  // And a copy kept for the burst, one datagram per reading
+  memcpy(&readings[readingCount * READING_SIZE], reading, READING_SIZE);
+  if (++readingCount == READINGS_PER_BURST) {
+    sent = lte.socketSendToBurst(udpSocket, SERVER_IP, SERVER_PORT, readings, sizeof(readings), READING_SIZE);
+    Serial.print(F("Burst sent "));
+    Serial.print(sent);
+    Serial.println(F(" bytes"));
+    readingCount = 0;
+  }
+}
@@ -0,0 +1,303 @@
+/*
+  Minimal Arduino core for building the SparkFun LTE Shield Arduino Library on a host
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include <chrono>
+#include <new>
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static unsigned long long delayed = 0; // us added by delay() and delayMicroseconds()
+static unsigned long heapAllocations = 0;
+
+// The link wraps malloc(), calloc() and realloc() (see CMakeLists.txt), new goes through malloc()
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t num, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    heapAllocations++;
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t num, size_t size)
+{
+    heapAllocations++;
+    return __real_calloc(num, size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+    heapAllocations++;
+    return __real_realloc(ptr, size);
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = malloc((size > 0) ? size : 1);
+
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t size) noexcept
+{
+    free(ptr);
+}
+
+unsigned long hostHeapAllocations(void)
+{
+    return heapAllocations;
+}
+
+unsigned long micros(void)
+{
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - startTime;
+
+    // Wraps like the real thing, after about 71 minutes
+    return (unsigned long)(uint32_t)(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() +
+                                     delayed);
+}
+
+unsigned long millis(void)
+{
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - startTime;
+
+    return (unsigned long)(uint32_t)((std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() +
+                                      delayed) / 1000);
+}
+
+void delay(unsigned long ms)
+{
+    delayed += (unsigned long long)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    delayed += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+}
+
+int digitalRead(uint8_t pin)
+{
+    return LOW;
+}
+
+String::String(double value, unsigned char decimals)
+{
+    char buf[48];
+
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    _str = buf;
+}
+
+void String::setNumber(long value, unsigned char base)
+{
+    char buf[24];
+
+    // Like the real core, other bases show negative numbers as unsigned
+    if (base != DEC)
+    {
+        setNumber((unsigned long)value, base);
+        return;
+    }
+    snprintf(buf, sizeof(buf), "%ld", value);
+    _str = buf;
+}
+
+void String::setNumber(unsigned long value, unsigned char base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+
+    if (base < 2)
+        base = 10;
+    *p = '\0';
+    do
+    {
+        unsigned long digit = value % base;
+        *--p = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+        value /= base;
+    } while (value > 0);
+    _str = p;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to)
+    {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= _str.size())
+        return String();
+    return String(_str.substr(from, to - from).c_str());
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < _str.size())
+        _str.erase(index, count);
+}
+
+void String::trim(void)
+{
+    size_t begin = 0;
+    size_t end = _str.size();
+
+    while ((begin < end) && isspace((unsigned char)_str[begin]))
+        begin++;
+    while ((end > begin) && isspace((unsigned char)_str[end - 1]))
+        end--;
+    _str = _str.substr(begin, end - begin);
+}
+
+void String::toCharArray(char *buf, unsigned int size, unsigned int index) const
+{
+    if ((buf == NULL) || (size == 0))
+        return;
+    if (index >= _str.size())
+    {
+        buf[0] = '\0';
+        return;
+    }
+    strncpy(buf, _str.c_str() + index, size - 1);
+    buf[size - 1] = '\0';
+}
+
+String operator+(const String &a, const String &b)
+{
+    String sum(a);
+
+    sum.concat(b);
+    return sum;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+
+    while (size-- > 0)
+    {
+        if (write(*buffer++) == 0)
+            break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::print(long value, int base)
+{
+    if ((base == DEC) && (value < 0))
+    {
+        size_t n = print('-');
+        return n + print((unsigned long)-value, base);
+    }
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(double value, int digits)
+{
+    return print(String(value, (unsigned char)digits));
+}
+
+bool Stream::find(const char *target)
+{
+    size_t targetLength = strlen(target);
+    size_t matched = 0;
+    int c;
+
+    if (targetLength == 0)
+        return true;
+    while ((c = timedRead()) >= 0)
+    {
+        if (c == target[matched])
+        {
+            if (++matched == targetLength)
+                return true;
+        }
+        else
+        {
+            matched = (c == target[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    int c;
+
+    while ((count < length) && ((c = timedRead()) >= 0))
+    {
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+int Stream::timedRead(void)
+{
+    unsigned long start = millis();
+    int c;
+
+    do
+    {
+        c = read();
+        if (c >= 0)
+            return c;
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    // The sketch's println() ends lines with "\r\n", a terminal only wants the '\n'
+    if (c != '\r')
+        fputc(c, stdout);
+    return 1;
+}
@@ -0,0 +1,246 @@
+/*
+  Minimal Arduino core for building the SparkFun LTE Shield Arduino Library on a host
+
+  Just enough of Print, Stream, HardwareSerial, String and the timing functions
+  for the library, LTE_Shield_Simulator and the simulator-only examples to build
+  and run under Linux. Serial writes to stdout. delay() moves the clock forward
+  without sleeping, so guard times and retry waits don't slow the tests down,
+  while millis() and micros() otherwise follow the real clock.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Flash strings are ordinary strings on a host
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define PSTR(s) (s)
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define strcpy_P strcpy
+#define strncmp_P strncmp
+#define strlen_P strlen
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Host only: malloc(), calloc(), realloc() and new calls since the program started,
+// for tests that check a path doesn't touch the heap
+unsigned long hostHeapAllocations(void);
+
+class String
+{
+public:
+    String(void) {}
+    String(const char *str) : _str(str != NULL ? str : "") {}
+    String(const __FlashStringHelper *str) : _str(reinterpret_cast<const char *>(str)) {}
+    explicit String(char c) : _str(1, c) {}
+    String(int value, unsigned char base = DEC) { setNumber((long)value, base); }
+    String(unsigned int value, unsigned char base = DEC) { setNumber((unsigned long)value, base); }
+    String(long value, unsigned char base = DEC) { setNumber(value, base); }
+    String(unsigned long value, unsigned char base = DEC) { setNumber(value, base); }
+    String(double value, unsigned char decimals = 2);
+
+    unsigned int length(void) const { return _str.size(); }
+    const char *c_str(void) const { return _str.c_str(); }
+    boolean reserve(unsigned int size)
+    {
+        _str.reserve(size);
+        return true;
+    }
+
+    boolean concat(const String &str)
+    {
+        _str += str._str;
+        return true;
+    }
+    boolean concat(const char *str)
+    {
+        _str += (str != NULL) ? str : "";
+        return true;
+    }
+    boolean concat(char c)
+    {
+        _str += c;
+        return true;
+    }
+    String &operator=(const char *str)
+    {
+        _str = (str != NULL) ? str : "";
+        return *this;
+    }
+    String &operator+=(const String &str)
+    {
+        concat(str);
+        return *this;
+    }
+    String &operator+=(const char *str)
+    {
+        concat(str);
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        concat(c);
+        return *this;
+    }
+
+    boolean operator==(const String &str) const { return _str == str._str; }
+    boolean operator==(const char *str) const { return _str == ((str != NULL) ? str : ""); }
+    boolean operator!=(const String &str) const { return _str != str._str; }
+    boolean operator!=(const char *str) const { return !(*this == str); }
+    boolean equals(const String &str) const { return _str == str._str; }
+    boolean startsWith(const String &prefix) const { return _str.compare(0, prefix._str.size(), prefix._str) == 0; }
+
+    char charAt(unsigned int index) const { return (index < _str.size()) ? _str[index] : '\0'; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    int indexOf(char c, unsigned int from = 0) const { return position(_str.find(c, from)); }
+    int indexOf(const char *str, unsigned int from = 0) const { return position(_str.find(str, from)); }
+    int lastIndexOf(char c) const { return position(_str.rfind(c)); }
+    String substring(unsigned int from) const { return substring(from, _str.size()); }
+    String substring(unsigned int from, unsigned int to) const;
+    void remove(unsigned int index) { remove(index, _str.size()); }
+    void remove(unsigned int index, unsigned int count);
+    void trim(void);
+    void toCharArray(char *buf, unsigned int size, unsigned int index = 0) const;
+    void getBytes(unsigned char *buf, unsigned int size, unsigned int index = 0) const
+    {
+        toCharArray((char *)buf, size, index);
+    }
+    long toInt(void) const { return atol(_str.c_str()); }
+    float toFloat(void) const { return (float)atof(_str.c_str()); }
+
+    friend String operator+(const String &a, const String &b);
+
+private:
+    std::string _str;
+
+    void setNumber(long value, unsigned char base);
+    void setNumber(unsigned long value, unsigned char base);
+    static int position(size_t index) { return (index == std::string::npos) ? -1 : (int)index; }
+};
+
+String operator+(const String &a, const String &b);
+
+class Print
+{
+public:
+    Print(void) : _writeError(0) {}
+    virtual ~Print(void) {}
+
+    int getWriteError(void) { return _writeError; }
+    void clearWriteError(void) { setWriteError(0); }
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return (str != NULL) ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite(void) { return 0; }
+    virtual void flush(void) {}
+
+    size_t print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+    size_t print(const String &str) { return write(str.c_str()); }
+    size_t print(const char *str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println(void) { return write("\r\n"); }
+    template <typename T>
+    size_t println(T value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(T value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+protected:
+    void setWriteError(int err = 1) { _writeError = err; }
+
+private:
+    int _writeError;
+};
+
+class Stream : public Print
+{
+public:
+    Stream(void) : _timeout(1000) {}
+
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout(void) { return _timeout; }
+    // Reads until target has been seen or the timeout passes without it
+    bool find(const char *target);
+    bool find(char *target) { return find((const char *)target); }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+protected:
+    unsigned long _timeout;
+
+    int timedRead(void);
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    virtual void begin(unsigned long baud) {}
+    virtual void end(void) {}
+    virtual int available(void) { return 0; }
+    virtual int read(void) { return -1; }
+    virtual int peek(void) { return -1; }
+    virtual size_t write(uint8_t c);
+    using Print::write;
+    operator bool(void) { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_H
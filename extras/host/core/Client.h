@@ -0,0 +1,38 @@
+/*
+  Minimal Arduino core for building the SparkFun LTE Shield Arduino Library on a host
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class Client : public Stream
+{
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) = 0;
+    virtual void stop(void) = 0;
+    virtual uint8_t connected(void) = 0;
+    virtual operator bool(void) = 0;
+
+protected:
+    uint8_t *rawIPAddress(IPAddress &addr) { return &addr[0]; }
+};
+
+#endif // CLIENT_H
@@ -0,0 +1,47 @@
+/*
+  Minimal Arduino core for building the SparkFun LTE Shield Arduino Library on a host
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include "Arduino.h"
+
+class IPAddress
+{
+public:
+    IPAddress(void) { memset(_address, 0, sizeof(_address)); }
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+    {
+        _address[0] = first;
+        _address[1] = second;
+        _address[2] = third;
+        _address[3] = fourth;
+    }
+    // Network byte order, first octet in the lowest byte
+    IPAddress(uint32_t address) { memcpy(_address, &address, sizeof(_address)); }
+
+    operator uint32_t(void) const
+    {
+        uint32_t address;
+
+        memcpy(&address, _address, sizeof(address));
+        return address;
+    }
+    bool operator==(const IPAddress &other) const { return memcmp(_address, other._address, sizeof(_address)) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+    uint8_t operator[](int index) const { return _address[index]; }
+    uint8_t &operator[](int index) { return _address[index]; }
+
+private:
+    uint8_t _address[4];
+};
+
+#endif // IPADDRESS_H
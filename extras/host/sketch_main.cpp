@@ -0,0 +1,26 @@
+/*
+  Runs an example sketch on the host: setup() once, then loop() once
+
+  Only sketches that talk to LTE_Shield_Simulator rather than a shield,
+  and finish their work in setup(), make sense here.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+
+void setup(void);
+void loop(void);
+
+int main(void)
+{
+    setup();
+    loop();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+  Tiny check macros for the host tests
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LTE_SHIELD_HOST_CHECK_H
+#define LTE_SHIELD_HOST_CHECK_H
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+// Report a failed condition and carry on, so one run shows every failure
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            checkFailures++;                                                 \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQUAL(actual, expected)                                                        \
+    do                                                                                       \
+    {                                                                                        \
+        long checkActual = (long)(actual);                                                   \
+        long checkExpected = (long)(expected);                                               \
+        if (checkActual != checkExpected)                                                    \
+        {                                                                                    \
+            printf("%s:%d: %s is %ld, expected %ld\n", __FILE__, __LINE__, #actual, checkActual, \
+                   checkExpected);                                                           \
+            checkFailures++;                                                                 \
+        }                                                                                    \
+    } while (0)
+
+static int checkResult(void)
+{
+    if (checkFailures > 0)
+        printf("%d check(s) failed\n", checkFailures);
+    else
+        printf("All checks passed\n");
+    return (checkFailures > 0) ? 1 : 0;
+}
+
+#endif // LTE_SHIELD_HOST_CHECK_H
@@ -0,0 +1,105 @@
+/*
+  LTE_ShieldClient tests against LTE_Shield_Simulator
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Client.h>
+#include <SparkFun_LTE_Shield_Simulator.h>
+#include "check.h"
+
+static int reads;
+static int lastReadLength;
+
+static const char *countReads(const char *command)
+{
+    if (strncmp(command, "+USORD=", 7) == 0)
+    {
+        reads++;
+        sscanf(command, "+USORD=%*d,%d", &lastReadLength);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    LTE_ShieldClient client(lte);
+    uint8_t buffer[200];
+    char urc[20];
+    int socket;
+
+    CHECK(lte.begin(sim));
+    sim.setCommandHandler(countReads);
+
+    // Nothing to read or write before connect()
+    CHECK(!client);
+    CHECK_EQUAL(client.connected(), 0);
+    CHECK_EQUAL(client.available(), 0);
+    CHECK_EQUAL(client.read(), -1);
+
+    CHECK_EQUAL(client.connect(IPAddress(10, 0, 0, 1), 80), 1);
+    CHECK(client);
+    socket = client.socket();
+    CHECK(socket >= 0);
+    CHECK_EQUAL(client.connected(), 1);
+    CHECK_EQUAL(client.write((const uint8_t *)"GET / HTTP/1.0\r\n\r\n", 18), 18);
+
+    // +UUSORD only records how much is waiting, nothing is read until asked for
+    reads = 0;
+    sim.receiveSocketData(socket, 100);
+    CHECK_EQUAL(client.available(), 100);
+    CHECK_EQUAL(reads, 0);
+
+    // Byte reads are served from the receive buffer, one +USORD per refill
+    int first = client.peek();
+    CHECK(first >= 0);
+    CHECK_EQUAL(reads, 1);
+    CHECK_EQUAL(lastReadLength, LTE_SHIELD_CLIENT_RX_BUFFER_SIZE);
+    CHECK_EQUAL(client.read(), first);
+    CHECK_EQUAL(client.available(), 99);
+    for (int i = 1; i < LTE_SHIELD_CLIENT_RX_BUFFER_SIZE; i++)
+        CHECK(client.read() >= 0);
+    CHECK_EQUAL(reads, 1);
+    CHECK(client.peek() >= 0);
+    CHECK_EQUAL(reads, 2);
+    CHECK_EQUAL(lastReadLength, 100 - LTE_SHIELD_CLIENT_RX_BUFFER_SIZE);
+    CHECK_EQUAL(client.available(), 100 - LTE_SHIELD_CLIENT_RX_BUFFER_SIZE);
+    while (client.available() > 0)
+        CHECK(client.read() >= 0);
+    CHECK_EQUAL(client.read(), -1);
+    CHECK_EQUAL(client.peek(), -1);
+
+    // read(buf, len) takes only what was asked for, the rest stays on the module
+    reads = 0;
+    sim.receiveSocketData(socket, 150);
+    CHECK_EQUAL(client.read(buffer, 10), 10);
+    CHECK_EQUAL(reads, 1);
+    CHECK_EQUAL(lastReadLength, 10);
+    CHECK_EQUAL(client.available(), 140);
+    CHECK_EQUAL(client.read(buffer, sizeof(buffer)), 140);
+    CHECK_EQUAL(client.available(), 0);
+    CHECK_EQUAL(client.read(buffer, sizeof(buffer)), -1);
+
+    // The far end closing shows up in connected(), but not before buffered data is read
+    sim.receiveSocketData(socket, 5);
+    CHECK(client.read() >= 0);
+    sprintf(urc, "+UUSOCL: %d", socket);
+    sim.sendUrc(urc);
+    CHECK_EQUAL(client.connected(), 1);
+    while (client.available() > 0)
+        client.read();
+    CHECK_EQUAL(client.connected(), 0);
+
+    client.stop();
+    CHECK(!client);
+    CHECK_EQUAL(client.socket(), -1);
+    return checkResult();
+}
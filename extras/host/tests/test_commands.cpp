@@ -0,0 +1,120 @@
+/*
+  Command engine tests against LTE_Shield_Simulator
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Simulator.h>
+#include "check.h"
+
+static char lastCommand[200];
+static char urcParams[40];
+static int callbacks;
+static const char *apnResponse; // Scripted answer to +CGDCONT?, NULL for the simulator's
+
+static const char *recordCommand(const char *command)
+{
+    strncpy(lastCommand, command, sizeof(lastCommand) - 1);
+    if (strcmp(command, "+CCLK?") == 0)
+        return "\r\n+CME ERROR: 10\r\n";
+    if (strcmp(command, "+CGDCONT?") == 0)
+        return apnResponse;
+    return NULL;
+}
+
+static void onCmti(const char *params)
+{
+    strncpy(urcParams, params, sizeof(urcParams) - 1);
+}
+
+static void onComplete(int handle, LTE_Shield_error_t result)
+{
+    callbacks++;
+}
+
+int main(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    unsigned long allocations;
+    int handle;
+
+    // Nothing to recover before begin()
+    struct RecoveryResult recovery = lte.recover();
+    CHECK_EQUAL(recovery.tier, LTE_SHIELD_RECOVERY_FAILED);
+    CHECK_EQUAL(recovery.pings, 0);
+
+    sim.setCommandHandler(recordCommand);
+    CHECK(lte.begin(sim));
+    CHECK_EQUAL(lte.recover().tier, LTE_SHIELD_RECOVERY_AT);
+    CHECK(lte.initStats().roundTrips > 0);
+
+    // Blocking and asynchronous commands
+    CHECK_EQUAL(lte.at(), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(lte.imei() == "352753090041680");
+    handle = lte.atAsync(onComplete);
+    CHECK(handle >= 0);
+    CHECK_EQUAL(lte.waitForCommand(handle), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(callbacks, 1);
+
+    // Commands are built in fixed slots, only the String getters use the heap
+    allocations = hostHeapAllocations();
+    CHECK_EQUAL(lte.at(), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(lte.waitForCommand(lte.atAsync()), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(lte.rssi() >= 0);
+    CHECK(lte.registration() != LTE_SHIELD_REGISTRATION_INVALID);
+    int socket = lte.socketOpen(LTE_SHIELD_TCP);
+    CHECK_EQUAL(lte.socketConnect(socket, "10.0.0.1", 80), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"hello", 5), 5);
+    CHECK_EQUAL(lte.socketClose(socket), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(hostHeapAllocations(), allocations);
+    CHECK(lte.ccid() == "8901410123456789012");
+    CHECK(hostHeapAllocations() > allocations);
+
+    // Errors come back with their code
+    CHECK_EQUAL(lte.autoTimeZone(true), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(lte.clock() == "");
+    CHECK_EQUAL(lte.lastErrorCode(), 10);
+
+    // String arguments longer than a command slot
+    CHECK_EQUAL(lte.setAPN("a.very.long.apn.name.that.goes.on.and.on.example.mnc001.mcc001.gprs"),
+                LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(strcmp(lastCommand, "+CGDCONT=1,\"IP\",\"a.very.long.apn.name.that.goes.on.and.on.example.mnc001."
+                              "mcc001.gprs\"") == 0);
+
+    // A response cut short by the capture buffer isn't parsed as if it were whole
+    String apn;
+    IPAddress ip;
+    apnResponse = "\r\n+CGDCONT: 1,\"IP\",\"hologram\",\"10.170.241.191\",0,0,0,0\r\n"
+                  "+CGDCONT: 2,\"IP\",\"a.second.context.with.a.long.apn.example.mnc001.mcc001.gprs\","
+                  "\"10.170.241.192\",0,0,0,0\r\n"
+                  "+CGDCONT: 3,\"IP\",\"a.third.context.with.a.long.apn.example.mnc001.mcc001.gprs\","
+                  "\"10.170.241.193\",0,0,0,0\r\n\r\nOK\r\n";
+    CHECK_EQUAL(lte.getAPN(&apn, &ip), LTE_SHIELD_ERROR_RESPONSE_OVERFLOW);
+    CHECK(apn == "");
+
+    // URCs reach registered handlers through poll()
+    CHECK(lte.setUrcHandler("+CMTI", onCmti));
+    sim.sendUrc("+CMTI: \"ME\",1");
+    lte.poll();
+    CHECK(strcmp(urcParams, "\"ME\",1") == 0);
+
+    // A URC that didn't fit is taken out of the response, so it doesn't count
+    apnResponse = "\r\n+CGDCONT: 1,\"IP\",\"hologram\",\"10.170.241.191\",0,0,0,0\r\n"
+                  "+CMTI: \"ME\",2,\"a.long.storage.name.that.fills.up.the.rest.of.the.capture.buffer\"\r\n"
+                  "\r\nOK\r\n";
+    CHECK_EQUAL(lte.getAPN(&apn, &ip), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(apn == "hologram");
+    CHECK(ip == IPAddress(10, 170, 241, 191));
+    apnResponse = NULL;
+    lte.poll();
+    CHECK(strncmp(urcParams, "\"ME\",2", 6) == 0);
+
+    return checkResult();
+}
@@ -0,0 +1,124 @@
+/*
+  Host name lookup and DNS cache tests against LTE_Shield_Simulator
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Simulator.h>
+#include "check.h"
+
+static char lastConnect[200];
+
+static const char *recordConnect(const char *command)
+{
+    if (strncmp(command, "+USOCO=", 7) == 0)
+        strncpy(lastConnect, command, sizeof(lastConnect) - 1);
+    return NULL;
+}
+
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+static void testCache(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    IPAddress first;
+    IPAddress second;
+    unsigned long commands;
+    int socket;
+
+    sim.setCommandHandler(recordConnect);
+    CHECK(lte.begin(sim));
+
+    // A second lookup is answered from the cache
+    CHECK_EQUAL(lte.resolve("ingest.example.com", &first), LTE_SHIELD_ERROR_SUCCESS);
+    commands = sim.commandsHandled();
+    CHECK_EQUAL(lte.resolve("ingest.example.com", &second), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(sim.commandsHandled(), commands);
+    CHECK(first == second);
+    CHECK_EQUAL(lte.dnsCacheStats().hits, 1);
+    CHECK_EQUAL(lte.dnsCacheStats().misses, 1);
+    CHECK_EQUAL(lte.dnsCacheStats().entries, 1);
+
+    // Failures aren't cached
+    CHECK_EQUAL(lte.resolve("nothing.invalid", &second), LTE_SHIELD_ERROR_CME_ERROR);
+    CHECK_EQUAL(lte.dnsCacheStats().failures, 1);
+    CHECK_EQUAL(lte.dnsCacheStats().entries, 1);
+
+    // socketConnect() goes to the cached address
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    CHECK_EQUAL(lte.socketConnect(socket, "ingest.example.com", 443), LTE_SHIELD_ERROR_SUCCESS);
+    char expected[40];
+    sprintf(expected, "+USOCO=%d,\"%d.%d.%d.%d\",443", socket, first[0], first[1], first[2], first[3]);
+    CHECK(strcmp(lastConnect, expected) == 0);
+
+    // A name that won't resolve fails the connect, counted as one miss
+    commands = sim.commandsHandled();
+    CHECK_EQUAL(lte.socketConnect(socket, "nothing.invalid", 443), LTE_SHIELD_ERROR_CME_ERROR);
+    CHECK_EQUAL(sim.commandsHandled(), commands + 1);
+    CHECK_EQUAL(lte.dnsCacheStats().misses, 3);
+    CHECK_EQUAL(lte.dnsCacheStats().failures, 2);
+
+    // With caching off the module looks the name up itself, no AT+UDNSRN first
+    lte.setDnsCacheTtl(0);
+    commands = sim.commandsHandled();
+    CHECK_EQUAL(lte.socketConnect(socket, "ingest.example.com", 443), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(sim.commandsHandled(), commands + 1);
+    CHECK(strcmp(lastConnect + strlen(lastConnect) - 24, "\"ingest.example.com\",443") == 0);
+    CHECK_EQUAL(lte.dnsCacheStats().misses, 3);
+    lte.setDnsCacheTtl(300000);
+
+    // Names longer than a command slot
+    CHECK_EQUAL(lte.resolve("a1b2c3d4e5f6g7-ats.iot.eu-central-1.amazonaws.example.com.xx", &second),
+                LTE_SHIELD_ERROR_SUCCESS);
+
+    lte.clearDnsCache();
+    CHECK_EQUAL(lte.dnsCacheStats().entries, 0);
+
+    // Pre-warming fills the cache on request, a name that won't resolve doesn't stop the rest
+    static const char *const hosts[] = {"ingest.example.com", "nothing.invalid", "api.example.com"};
+    CHECK_EQUAL(lte.prewarmDnsCache(hosts, 3), 2);
+    CHECK_EQUAL(lte.dnsCacheStats().entries, 2);
+    commands = sim.commandsHandled();
+    CHECK_EQUAL(lte.resolve("api.example.com", &second), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(sim.commandsHandled(), commands);
+}
+#else
+static void testNoCache(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    IPAddress ip;
+    unsigned long commands;
+    int socket;
+
+    // Built without the cache, every lookup goes to the module and connects pass the name on
+    sim.setCommandHandler(recordConnect);
+    CHECK(lte.begin(sim));
+    commands = sim.commandsHandled();
+    CHECK_EQUAL(lte.resolve("ingest.example.com", &ip), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(lte.resolve("ingest.example.com", &ip), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(sim.commandsHandled(), commands + 2);
+    CHECK_EQUAL(lte.dnsCacheStats().entries, 0);
+
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    commands = sim.commandsHandled();
+    CHECK_EQUAL(lte.socketConnect(socket, "ingest.example.com", 443), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(sim.commandsHandled(), commands + 1);
+}
+#endif
+
+int main(void)
+{
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    testCache();
+#else
+    testNoCache();
+#endif
+    return checkResult();
+}
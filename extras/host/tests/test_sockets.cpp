@@ -0,0 +1,358 @@
+/*
+  Socket tests against LTE_Shield_Simulator
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Simulator.h>
+#include "check.h"
+
+static size_t receivedLength;
+static unsigned long consumed;
+static IPAddress datagramIP;
+static unsigned int datagramPort;
+static size_t datagramLengths[4];
+static int datagrams;
+
+static void onData(int socket, const uint8_t *data, size_t length)
+{
+    receivedLength += length;
+}
+
+static void onDatagram(int socket, const uint8_t *data, size_t length, IPAddress remoteIP, unsigned int remotePort)
+{
+    datagramIP = remoteIP;
+    datagramPort = remotePort;
+    if (datagrams < 4)
+        datagramLengths[datagrams] = length;
+    datagrams++;
+}
+
+static void consume(int socket, const uint8_t *data, size_t length)
+{
+    consumed += length;
+}
+
+static void testLoopback(lte_shield_data_mode_t mode)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    uint8_t payload[300];
+    int socket;
+
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = (uint8_t)i; // NULs and all
+    CHECK(lte.begin(sim));
+    lte.setSocketDataMode(mode);
+    lte.setSocketDataCallback(onData);
+    sim.setLoopback(true);
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    CHECK(socket >= 0);
+    CHECK_EQUAL(lte.socketConnect(socket, "10.0.0.1", 80), LTE_SHIELD_ERROR_SUCCESS);
+
+    receivedLength = 0;
+    CHECK_EQUAL(lte.socketWrite(socket, payload, sizeof(payload)), sizeof(payload));
+    for (int i = 0; (i < 100) && (receivedLength < sizeof(payload)); i++)
+        lte.poll();
+    CHECK_EQUAL(receivedLength, sizeof(payload)); // The simulator echoes the length, not the bytes
+    CHECK_EQUAL(lte.socketClose(socket), LTE_SHIELD_ERROR_SUCCESS);
+}
+
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+static boolean refuseWrites;
+static int writeAttempts;
+
+static const char *countWrites(const char *command)
+{
+    if (strncmp(command, "+USOWR", 6) != 0)
+        return NULL;
+    writeAttempts++;
+    return refuseWrites ? "\r\nERROR\r\n" : NULL;
+}
+
+static void testWriteBuffer(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    static uint8_t buffer[100];
+    unsigned long commands;
+    int socket;
+
+    CHECK(lte.begin(sim));
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    CHECK_EQUAL(lte.setSocketWriteBuffer(socket, buffer, sizeof(buffer), 60, 200), LTE_SHIELD_ERROR_SUCCESS);
+
+    // Collected until the threshold, then sent as one +USOWR
+    commands = sim.commandsHandled();
+    for (int i = 0; i < 5; i++)
+        CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"0123456789", 10), 10);
+    CHECK_EQUAL(sim.commandsHandled(), commands);
+    CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"0123456789", 10), 10);
+    CHECK_EQUAL(lte.socketWriteStats(socket).flushes, 1);
+    CHECK_EQUAL(lte.socketWriteStats(socket).bytes, 60);
+
+    // socketClose() sends what's left
+    CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"01234", 5), 5);
+    CHECK_EQUAL(lte.socketClose(socket), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(lte.socketWriteStats(socket).bytes, 65);
+}
+
+static void testPollFlush(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    static uint8_t buffer[100];
+    int socket;
+    int attempts;
+
+    CHECK(lte.begin(sim));
+    sim.setCommandHandler(countWrites);
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    CHECK_EQUAL(lte.setSocketWriteBuffer(socket, buffer, sizeof(buffer), 60, 200), LTE_SHIELD_ERROR_SUCCESS);
+
+    // Once maxLatency passes, poll() queues the write and returns without waiting on it
+    CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"0123456789", 10), 10);
+    lte.poll();
+    CHECK_EQUAL(lte.pendingCommands(), 0);
+    delay(200);
+    lte.poll();
+    CHECK_EQUAL(lte.pendingCommands(), 1);
+    CHECK_EQUAL(lte.socketWriteStats(socket).flushes, 0);
+    for (int i = 0; (i < 100) && (lte.socketWriteStats(socket).flushes == 0); i++)
+        lte.poll();
+    CHECK_EQUAL(lte.socketWriteStats(socket).bytes, 10);
+
+    // A failed write is retried after a backoff, not on every poll()
+    refuseWrites = true;
+    writeAttempts = 0;
+    CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"0123456789", 10), 10);
+    delay(200);
+    for (int i = 0; i < 100; i++)
+        lte.poll();
+    CHECK_EQUAL(writeAttempts, 1);
+    delay(250);
+    for (int i = 0; i < 100; i++)
+        lte.poll();
+    CHECK_EQUAL(writeAttempts, 2);
+    delay(250);
+    for (int i = 0; i < 100; i++)
+        lte.poll();
+    CHECK_EQUAL(writeAttempts, 2); // Backoff has doubled
+    refuseWrites = false;
+    attempts = writeAttempts;
+    delay(250);
+    for (int i = 0; (i < 100) && (lte.socketWriteStats(socket).bytes < 20); i++)
+        lte.poll();
+    CHECK_EQUAL(writeAttempts, attempts + 1);
+    CHECK_EQUAL(lte.socketWriteStats(socket).bytes, 20);
+
+    // Closing doesn't quietly drop what's still buffered
+    refuseWrites = true;
+    CHECK_EQUAL(lte.socketWrite(socket, (const uint8_t *)"01234", 5), 5);
+    CHECK_EQUAL(lte.socketCloseAsync(socket), -LTE_SHIELD_ERROR_UNEXPECTED_PARAM);
+    CHECK_EQUAL(lte.socketClose(socket), LTE_SHIELD_ERROR_ERROR);
+    CHECK_EQUAL(lte.socketWriteStats(socket).bytes, 20);
+    refuseWrites = false;
+}
+
+#endif
+
+static void testReadAll(lte_shield_data_mode_t mode)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    char buffer[200];
+    int socket;
+
+    CHECK(lte.begin(sim));
+    lte.setSocketDataMode(mode);
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    lte.deferSocketRead(socket, true);
+    sim.receiveSocketData(socket, 5000);
+    lte.poll();
+    CHECK_EQUAL(lte.socketAvailable(socket), 5000);
+
+    consumed = 0;
+    CHECK_EQUAL(lte.socketReadAll(socket, buffer, sizeof(buffer), consume), 5000);
+    CHECK_EQUAL(consumed, 5000);
+    CHECK_EQUAL(lte.socketAvailable(socket), 0);
+}
+
+static int connects;
+static int connectSocket;
+static int connectError;
+
+static void onConnect(int socket, int error, unsigned long elapsed)
+{
+    connects++;
+    connectSocket = socket;
+    connectError = error;
+}
+
+static const char *acceptConnects(const char *command)
+{
+    // OK to the background connect, the test sends the +UUSOCO itself
+    if ((strncmp(command, "+USOCO=", 7) == 0) && (strstr(command, ",1") != NULL))
+        return "\r\nOK\r\n";
+    return NULL;
+}
+
+static void testConnectStart(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    char urc[20];
+    int socket;
+
+    CHECK(lte.begin(sim));
+    lte.setSocketConnectCallback(onConnect);
+    sim.setConnectTime(100);
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+
+    // Back as soon as the module takes it, +UUSOCO reports the connection through poll()
+    connects = 0;
+    CHECK_EQUAL(lte.socketConnectStart(socket, "10.0.0.1", 80), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(lte.socketConnecting(socket));
+    CHECK_EQUAL(connects, 0);
+
+    // A second attempt while that one's in progress is refused, and doesn't end the first
+    CHECK(lte.socketConnectStart(socket, "10.0.0.2", 80) != LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(lte.socketConnecting(socket));
+    CHECK_EQUAL(connects, 0);
+
+    for (int i = 0; (i < 1000) && (connects == 0); i++)
+    {
+        delay(1);
+        lte.poll();
+    }
+    CHECK_EQUAL(connects, 1);
+    CHECK_EQUAL(connectSocket, socket);
+    CHECK_EQUAL(connectError, 0);
+    CHECK(!lte.socketConnecting(socket));
+    CHECK_EQUAL(lte.socketClose(socket), LTE_SHIELD_ERROR_SUCCESS);
+
+    // A socket error ends it too, with the error in the callback
+    sim.setCommandHandler(acceptConnects);
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+    connects = 0;
+    CHECK_EQUAL(lte.socketConnectStart(socket, "10.0.0.1", 80), LTE_SHIELD_ERROR_SUCCESS);
+    CHECK(lte.socketConnecting(socket));
+    sprintf(urc, "+UUSOCO: %d,111", socket);
+    sim.sendUrc(urc);
+    lte.poll();
+    CHECK_EQUAL(connects, 1);
+    CHECK_EQUAL(connectSocket, socket);
+    CHECK_EQUAL(connectError, 111);
+    CHECK(!lte.socketConnecting(socket));
+}
+
+static void testReadWithSlotsFull(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    char buffer[200];
+    int socket;
+
+    CHECK(lte.begin(sim));
+    lte.setSocketDataCallback(onData);
+    socket = lte.socketOpen(LTE_SHIELD_TCP);
+
+    // Asleep, so every slot holds a queued command when +UUSORD arrives
+    sim.sendUrc("+UUPSMR: 1");
+    lte.poll();
+    for (int i = 0; i < LTE_SHIELD_MAX_PENDING_COMMANDS; i++)
+        CHECK(lte.atAsync() >= 0);
+    receivedLength = 0;
+    sim.receiveSocketData(socket, 300);
+    lte.poll();
+    CHECK_EQUAL(receivedLength, 0);
+    CHECK_EQUAL(lte.socketAvailable(socket), 300);
+
+    // Not announced again, but still there once the slots are free
+    sim.sendUrc("+UUPSMR: 0");
+    for (int i = 0; (i < 100) && (lte.pendingCommands() > 0); i++)
+        lte.poll();
+    consumed = 0;
+    CHECK_EQUAL(lte.socketReadAll(socket, buffer, sizeof(buffer), consume), 300);
+    CHECK_EQUAL(consumed, 300);
+    CHECK_EQUAL(lte.socketAvailable(socket), 0);
+}
+
+static void testUdp(void)
+{
+    LTE_Shield_Simulator sim;
+    LTE_Shield lte;
+    uint8_t payload[100];
+    char buffer[200];
+    int readLength = 0;
+    IPAddress remoteIP;
+    unsigned int remotePort = 0;
+    int socket;
+
+    memset(payload, 'u', sizeof(payload));
+    CHECK(lte.begin(sim));
+    socket = lte.socketOpen(LTE_SHIELD_UDP);
+    CHECK_EQUAL(lte.socketSendTo(socket, "10.1.2.3", 5000, payload, sizeof(payload)), sizeof(payload));
+
+    // Loopback data comes back from the last destination
+    sim.setLoopback(true);
+    lte.deferSocketRead(socket, true);
+    CHECK_EQUAL(lte.socketSendTo(socket, "10.1.2.4", 5001, payload, 50), 50);
+    lte.poll();
+    CHECK_EQUAL(lte.socketRecvFrom(socket, sizeof(buffer), buffer, &readLength, &remoteIP, &remotePort),
+                LTE_SHIELD_ERROR_SUCCESS);
+    CHECK_EQUAL(readLength, 50);
+    CHECK(remoteIP == IPAddress(10, 1, 2, 4));
+    CHECK_EQUAL(remotePort, 5001);
+
+    // Or through the callback when not deferred
+    lte.deferSocketRead(socket, false);
+    lte.setSocketRecvFromCallback(onDatagram);
+    sim.setLoopback(false);
+    sim.receiveSocketData(socket, 40);
+    lte.poll();
+    CHECK(datagramIP == IPAddress(10, 1, 2, 4));
+    CHECK_EQUAL(datagramPort, 5001);
+
+    // Each datagram comes in one read, cut short without a buffer big enough
+    static uint8_t datagramBuffer[201];
+    datagrams = 0;
+    sim.receiveSocketData(socket, 150);
+    sim.receiveSocketData(socket, 120);
+    for (int i = 0; (i < 10) && (datagrams < 2); i++)
+        lte.poll();
+    CHECK_EQUAL(datagrams, 2);
+    CHECK_EQUAL(datagramLengths[0], LTE_SHIELD_SOCKET_READ_CHUNK);
+    CHECK_EQUAL(datagramLengths[1], LTE_SHIELD_SOCKET_READ_CHUNK);
+    lte.setSocketRecvFromBuffer(datagramBuffer, sizeof(datagramBuffer));
+    datagrams = 0;
+    sim.receiveSocketData(socket, 150);
+    sim.receiveSocketData(socket, 250);
+    for (int i = 0; (i < 10) && (datagrams < 2); i++)
+        lte.poll();
+    CHECK_EQUAL(datagrams, 2);
+    CHECK_EQUAL(datagramLengths[0], 150);
+    CHECK_EQUAL(datagramLengths[1], 200);
+}
+
+int main(void)
+{
+    testLoopback(LTE_SHIELD_DATA_MODE_TEXT);
+    testLoopback(LTE_SHIELD_DATA_MODE_HEX);
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    testWriteBuffer();
+    testPollFlush();
+#endif
+    testReadAll(LTE_SHIELD_DATA_MODE_TEXT);
+    testReadAll(LTE_SHIELD_DATA_MODE_HEX);
+    testConnectStart();
+    testReadWithSlotsFull();
+    testUdp();
+    return checkResult();
+}
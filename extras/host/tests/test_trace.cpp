@@ -0,0 +1,104 @@
+/*
+  Trace record and replay tests, built with LTE_SHIELD_ENABLE_TRACE=1
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SparkFun_LTE_Shield_Arduino_Library.h>
+#include <SparkFun_LTE_Shield_Simulator.h>
+#include <SparkFun_LTE_Shield_Replay.h>
+#include "check.h"
+
+struct Session
+{
+    boolean begun;
+    String imei;
+    int socket;
+    LTE_Shield_error_t connect;
+    int written;
+    size_t received;
+    LTE_Shield_error_t close;
+};
+
+static size_t receivedLength;
+
+static void onData(int socket, const uint8_t *data, size_t length)
+{
+    receivedLength += length;
+}
+
+// The same calls whether the other end is the simulator or a replay of it
+static struct Session runSession(LTE_Shield &lte, Stream &stream)
+{
+    struct Session session;
+    uint8_t payload[100];
+
+    memset(payload, 'r', sizeof(payload));
+    session.begun = lte.begin(stream);
+    lte.setSocketDataCallback(onData);
+    session.imei = lte.imei();
+    session.socket = lte.socketOpen(LTE_SHIELD_TCP);
+    session.connect = lte.socketConnect(session.socket, "10.0.0.1", 80);
+    receivedLength = 0;
+    session.written = lte.socketWrite(session.socket, payload, sizeof(payload));
+    for (int i = 0; (i < 1000) && (receivedLength < sizeof(payload)); i++)
+        lte.poll();
+    session.received = receivedLength;
+    session.close = lte.socketClose(session.socket);
+    return session;
+}
+
+int main(void)
+{
+    static uint8_t trace[LTE_SHIELD_TRACE_SIZE];
+    struct Session recorded, replayed;
+    size_t length;
+
+    // Record against the simulator
+    {
+        LTE_Shield_Simulator sim;
+        LTE_Shield lte;
+
+        sim.setLoopback(true);
+        lte.traceEnable();
+        recorded = runSession(lte, sim);
+        CHECK(recorded.begun);
+        CHECK_EQUAL(recorded.received, 100);
+        length = lte.traceCopy(trace, sizeof(trace));
+        CHECK_EQUAL(length, lte.traceLength());
+        CHECK(length < sizeof(trace)); // Nothing dropped off the front
+    }
+
+    // Replay as fast as the library reads, it should see and send the same bytes
+    {
+        LTE_Shield_Replay replay(trace, length, 0);
+        LTE_Shield lte;
+
+        replayed = runSession(lte, replay);
+        CHECK_EQUAL(replay.mismatches(), 0);
+        CHECK(replay.finished());
+    }
+
+    CHECK_EQUAL(replayed.begun, recorded.begun);
+    CHECK(replayed.imei == recorded.imei);
+    CHECK_EQUAL(replayed.socket, recorded.socket);
+    CHECK_EQUAL(replayed.connect, recorded.connect);
+    CHECK_EQUAL(replayed.written, recorded.written);
+    CHECK_EQUAL(replayed.received, recorded.received);
+    CHECK_EQUAL(replayed.close, recorded.close);
+
+    // A diverging library is caught
+    {
+        LTE_Shield_Replay replay(trace, length, 0);
+
+        replay.print("AT+WRONG\r\n");
+        CHECK(replay.mismatches() > 0);
+        CHECK(!replay.finished());
+    }
+    return checkResult();
+}
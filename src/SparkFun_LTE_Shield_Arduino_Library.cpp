@@ -28,18 +28,39 @@
 */
 
 #include <SparkFun_LTE_Shield_Arduino_Library.h>
+#ifdef ARDUINO_ARCH_AVR
+#include <EEPROM.h>
+#endif
 
 #define LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT 1000
 #define LTE_SHIELD_SET_BAUD_TIMEOUT 500
+#define LTE_SHIELD_AUTOBAUD_TIMEOUT 200 // Per rate tried, the modem answers "AT" well within this
+#define LTE_SHIELD_AUTOBAUD_PASSES 2    // Times autobaud() walks the supported rates before giving up
+// recover(): how long each step waits for the modem to answer, and the gaps between pings
+#define LTE_SHIELD_RECOVERY_AT_BUDGET 3000
+#define LTE_SHIELD_SILENT_RESET_BUDGET 10000 // reset()'s AT+CFUN=15
+#define LTE_SHIELD_RECOVERY_HW_RESET_BUDGET 15000
+#define LTE_SHIELD_RECOVERY_POWER_BUDGET 15000 // Per PWR_ON pulse
+#define LTE_SHIELD_RECOVERY_BACKOFF_MIN 250
+#define LTE_SHIELD_RECOVERY_BACKOFF_MAX 2000
 #define LTE_SHIELD_POWER_PULSE_PERIOD 3200
 #define LTE_RESET_PULSE_PERIOD 10000
+#define LTE_SHIELD_WAKE_PULSE_PERIOD 200 // PWR_ON pulse that brings the modem out of PSM
+#define LTE_SHIELD_WAKE_TIMEOUT 5000     // Assume it's awake if no +UUPSMR arrives within this
 #define LTE_SHIELD_IP_CONNECT_TIMEOUT 60000
+#define LTE_SHIELD_DNS_TIMEOUT 70000      // +UDNSRN can take this long with no answer from the network
+#define LTE_SHIELD_DNS_DEFAULT_TTL 300000
 #define LTE_SHIELD_POLL_DELAY 1
 #define LTE_SHIELD_SOCKET_WRITE_TIMEOUT 10000
+#define LTE_SHIELD_FLUSH_BACKOFF_MIN 250 // Before poll() retries a buffered write that failed
+#define LTE_SHIELD_FLUSH_BACKOFF_MAX 8000
+#define LTE_SHIELD_DIRECT_LINK_TIMEOUT 3000 // For CONNECT, and for DISCONNECT after the escape
+#define LTE_SHIELD_DIRECT_LINK_GUARD 1200   // Silence either side of "+++", the module wants 1 s
 
 // ## Suported AT Commands
 // ### General
 const char LTE_SHIELD_COMMAND_AT[] = "AT";      // AT "Test"
+const char LTE_SHIELD_COMMAND_CMEE[] = "+CMEE"; // Report mobile termination error
 const char LTE_SHIELD_COMMAND_ECHO[] = "E";     // Local Echo
 const char LTE_SHIELD_COMMAND_IMEI[] = "+CGSN"; // IMEI identification
 const char LTE_SHIELD_COMMAND_IMSI[] = "+CIMI"; // IMSI identification
@@ -55,6 +76,13 @@ const char LTE_SHIELD_REGISTRATION_STATUS[] = "+CREG";
 const char LTE_SHIELD_MESSAGE_PDP_DEF[] = "+CGDCONT";
 const char LTE_SHIELD_MESSAGE_ENTER_PPP[] = "D";
 const char LTE_SHIELD_OPERATOR_SELECTION[] = "+COPS";
+// ### Power saving
+const char LTE_SHIELD_PSM[] = "+CPSMS";           // Request Power Saving Mode timers
+const char LTE_SHIELD_PSM_GRANTED[] = "+UCPSMS";  // PSM timers granted by the network
+const char LTE_SHIELD_PSM_URC[] = "+UPSMR";       // Enable +UUPSMR sleep/wake indications
+const char LTE_SHIELD_EDRX[] = "+CEDRXS";         // Request an eDRX cycle
+const char LTE_SHIELD_EDRX_GRANTED[] = "+CEDRXRDP"; // eDRX cycle granted by the network
+const char LTE_SHIELD_UART_POWER_SAVING[] = "+UPSV";
 // V24 control and V25ter (UART interface)
 const char LTE_SHIELD_COMMAND_BAUD[] = "+IPR"; // Baud rate
 // ### GPIO
@@ -65,7 +93,12 @@ const char LTE_SHIELD_CLOSE_SOCKET[] = "+USOCL";   // Close a socket
 const char LTE_SHIELD_CONNECT_SOCKET[] = "+USOCO"; // Connect to server on socket
 const char LTE_SHIELD_WRITE_SOCKET[] = "+USOWR";   // Write data to a socket
 const char LTE_SHIELD_READ_SOCKET[] = "+USORD";    // Read from a socket
+const char LTE_SHIELD_SEND_TO_SOCKET[] = "+USOST"; // Send a UDP datagram
+const char LTE_SHIELD_RECV_FROM[] = "+USORF";      // Receive a UDP datagram and its source
 const char LTE_SHIELD_LISTEN_SOCKET[] = "+USOLI";  // Listen for connection on socket
+const char LTE_SHIELD_DATA_CONFIG[] = "+UDCONF";   // Data configuration, parameter 1 is hex mode
+const char LTE_SHIELD_DIRECT_LINK[] = "+USODL";    // Direct link mode on a connected socket
+const char LTE_SHIELD_RESOLVE_NAME[] = "+UDNSRN";  // Resolve a host name
 // ### SMS
 const char LTE_SHIELD_MESSAGE_FORMAT[] = "+CMGF"; // Set SMS message format
 const char LTE_SHIELD_SEND_TEXT[] = "+CMGS";      // Send SMS message
@@ -75,6 +108,24 @@ const char LTE_SHIELD_GPS_REQUEST_LOCATION[] = "+ULOC";
 const char LTE_SHIELD_GPS_GPRMC[] = "+UGRMC";
 
 const char LTE_SHIELD_RESPONSE_OK[] = "OK\r\n";
+const char LTE_SHIELD_RESPONSE_CONNECT[] = "CONNECT\r\n";
+const char LTE_SHIELD_DIRECT_LINK_ESCAPE[] = "+++";
+
+// Final result codes that end a command early, whatever it was waiting for
+const char LTE_SHIELD_RESPONSE_CME_ERROR[] = "+CME ERROR:";
+const char LTE_SHIELD_RESPONSE_CMS_ERROR[] = "+CMS ERROR:";
+const struct
+{
+    const char *line;
+    LTE_Shield_error_t err;
+} LTE_SHIELD_FINAL_RESULTS[] =
+    {
+        {"ERROR", LTE_SHIELD_ERROR_ERROR},
+        {"ABORTED", LTE_SHIELD_ERROR_ERROR},
+        {"NO CARRIER", LTE_SHIELD_ERROR_NO_CARRIER},
+        {"BUSY", LTE_SHIELD_ERROR_NO_CARRIER},
+        {"NO ANSWER", LTE_SHIELD_ERROR_NO_CARRIER},
+        {"NO DIALTONE", LTE_SHIELD_ERROR_NO_CARRIER}};
 
 // CTRL+Z and ESC ASCII codes for SMS message sends
 const char ASCII_CTRL_Z = 0x1A;
@@ -83,7 +134,21 @@ const char ASCII_ESC = 0x1B;
 #define NOT_AT_COMMAND false
 #define AT_COMMAND true
 
-#define LTE_SHIELD_NUM_SOCKETS 6
+// Hex data mode digits, indexed by nibble
+static const char LTE_SHIELD_HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Per-socket state
+#define LTE_SHIELD_SOCKET_DEFERRED 0x01 // Reads are left to the application
+#define LTE_SHIELD_SOCKET_CLOSED 0x02   // +UUSOCL seen
+#define LTE_SHIELD_SOCKET_CONNECTING 0x04 // Background +USOCO accepted, no +UUSOCO yet
+
+// Settings applied by init(), as bits of a mask
+#define LTE_SHIELD_CONFIG_CMEE 0x01
+#define LTE_SHIELD_CONFIG_GPIO1 0x02
+#define LTE_SHIELD_CONFIG_GPIO2 0x04
+#define LTE_SHIELD_CONFIG_CMGF 0x08
+#define LTE_SHIELD_CONFIG_CTZU 0x10
+#define LTE_SHIELD_CONFIG_HEX 0x20 // Not a setting we apply, records the module's data mode
 
 #define NUM_SUPPORTED_BAUD 6
 const unsigned long LTE_SHIELD_SUPPORTED_BAUD[NUM_SUPPORTED_BAUD] =
@@ -96,25 +161,171 @@ const unsigned long LTE_SHIELD_SUPPORTED_BAUD[NUM_SUPPORTED_BAUD] =
         230400};
 #define LTE_SHIELD_DEFAULT_BAUD_RATE 115200
 
-char lteShieldRXBuffer[128];
+// 3GPP TS 24.008 timer units in seconds, indexed by the top 3 bits of the timer octet.
+// Unit 7 means the timer is deactivated.
+#define NUM_PSM_TAU_UNITS 7
+const unsigned long LTE_SHIELD_PSM_TAU_UNITS[NUM_PSM_TAU_UNITS] = // T3412 extended
+    {600, 3600, 36000, 2, 30, 60, 1152000};
+#define NUM_PSM_ACTIVE_UNITS 3
+const unsigned long LTE_SHIELD_PSM_ACTIVE_UNITS[NUM_PSM_ACTIVE_UNITS] = // T3324
+    {2, 60, 360};
+
+// Cat M1 eDRX cycle lengths in ms, indexed by the 4-bit eDRX value
+#define NUM_EDRX_CYCLES 16
+const unsigned long LTE_SHIELD_EDRX_CYCLES[NUM_EDRX_CYCLES] =
+    {5120, 10240, 20480, 40960, 61440, 81920, 102400, 122880,
+     143360, 163840, 327680, 655360, 1310720, 2621440, 5242880, 10485760};
+#define LTE_SHIELD_EDRX_PTW_UNIT 1280 // Cat M1 paging time window step, ms
+#define LTE_SHIELD_EDRX_ACT_CAT_M1 4
+
+static boolean supportedBaud(unsigned long baud)
+{
+    for (int b = 0; b < NUM_SUPPORTED_BAUD; b++)
+    {
+        if (LTE_SHIELD_SUPPORTED_BAUD[b] == baud)
+            return true;
+    }
+    return false;
+}
+
+#ifdef ARDUINO_ARCH_AVR
+static int _baudEepromAddress;
+
+static unsigned long loadBaudEeprom(void)
+{
+    unsigned long baud;
+
+    EEPROM.get(_baudEepromAddress, baud);
+    return supportedBaud(baud) ? baud : 0; // Erased EEPROM reads 0xFFFFFFFF
+}
+
+static void saveBaudEeprom(unsigned long baud)
+{
+    EEPROM.put(_baudEepromAddress, baud);
+}
+#endif
+
+// Built-in unsolicited result code handlers, dispatched by prefix from poll()
+const LTE_Shield::LTE_Shield_urc_handler_t LTE_Shield::_urcHandlers[] =
+    {
+        {"+UUSORD", &LTE_Shield::urcSocketRead},
+        {"+UUSORF", &LTE_Shield::urcSocketRecvFrom},
+        {"+UUSOLI", &LTE_Shield::urcSocketListen},
+        {"+UUSOCL", &LTE_Shield::urcSocketClose},
+        {"+UUSOCO", &LTE_Shield::urcSocketConnect},
+        {"+UULOC", &LTE_Shield::urcLocation},
+        {"+UUPSMR", &LTE_Shield::urcPowerSaving}};
+
+#define LTE_SHIELD_HANDLE_MASK 0x7FFF // Command handles wrap within positive ints
+#define LTE_SHIELD_COMMAND_TAIL 16     // Room appendCommandQuoted() leaves for the arguments after it, e.g. ",65535,1"
 
 static boolean parseGPRMCString(char *rmcString, PositionData *pos, ClockData *clk, SpeedData *spd);
 
+static LTE_Shield_error_t parseIdentityResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseCcidResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseClockStringResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseClockResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseRssiResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseRegistrationResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseMnoResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseApnResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseOperatorRecord(char *record, void **results, int maxOps);
+static LTE_Shield_error_t parseConfigRecord(char *record, void **results, int arg);
+static LTE_Shield_error_t parseOperatorResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseGpioModeResponse(char *response, void **results, int gpio);
+static LTE_Shield_error_t parseSocketOpenResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseSocketConnectStartResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseSocketWriteResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseSocketReadResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseSocketRecvFromResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseGpsOnResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseRmcResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parsePsmResponse(char *response, void **results, int arg);
+static LTE_Shield_error_t parseEdrxResponse(char *response, void **results, int arg);
+static void encodePsmTimer(unsigned long seconds, const unsigned long *units, int numUnits, char *bits);
+static unsigned long decodePsmTimer(const char *bits, const unsigned long *units, int numUnits);
+static LTE_Shield_error_t parseResolveResponse(char *response, void **results, int arg);
+static uint8_t hexNibble(char c);
+static boolean isIpAddress(const char *address);
+
 LTE_Shield::LTE_Shield(uint8_t powerPin, uint8_t resetPin)
 {
 #ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
     _softSerial = NULL;
 #endif
     _hardSerial = NULL;
+    _serialPort = NULL;
     _baud = 0;
     _resetPin = resetPin;
     _powerPin = powerPin;
     _socketReadCallback = NULL;
+    _socketDataCallback = NULL;
     _socketCloseCallback = NULL;
+    _socketRecvFromCallback = NULL;
+    _recvFromBuffer = NULL;
+    _recvFromBufferSize = 0;
+    _socketConnectCallback = NULL;
+    _gpsRequestCallback = NULL;
+    _sleepCallback = NULL;
+    _asleep = false;
+    _wakeRequested = false;
+    _wakeTime = 0;
     _lastRemoteIP = {0, 0, 0, 0};
     _lastLocalIP = {0, 0, 0, 0};
 
-    memset(lteShieldRXBuffer, 0, 128);
+    memset(_userUrcHandlers, 0, sizeof(_userUrcHandlers));
+    _urcQueueLength = 0;
+    _droppedUrcs = 0;
+
+    _rxHead = 0;
+    _rxTail = 0;
+    _rxLineLength = 0;
+    _rxLineOverflow = false;
+
+    memset(_commands, 0, sizeof(_commands));
+    _activeCommand = NULL;
+    _nextHandle = 0;
+    _lastErrorCode = 0;
+    _commandsSent = 0;
+    _initStats.roundTrips = 0;
+    _initStats.duration = 0;
+    _initStats.autobaudProbes = 0;
+    _initStats.autobaudDuration = 0;
+    _freshBoot = false;
+    _dataMode = LTE_SHIELD_DATA_MODE_TEXT;
+    _modemDataMode = -1;
+    memset(_socketFlags, 0, sizeof(_socketFlags));
+    memset(_socketUnread, 0, sizeof(_socketUnread));
+    memset(_socketConnectStart, 0, sizeof(_socketConnectStart));
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    memset(_txBuffers, 0, sizeof(_txBuffers));
+    _txFlushing = false;
+#endif
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    memset(_dnsCache, 0, sizeof(_dnsCache));
+    _dnsTtl = LTE_SHIELD_DNS_DEFAULT_TTL;
+#else
+    _dnsTtl = 0; // No cache, so caching is off
+#endif
+    _dnsHits = 0;
+    _dnsMisses = 0;
+    _dnsFailures = 0;
+    _directLink = false;
+    _directLinkStart = 0;
+    _directLinkEnd = 0;
+    _directLinkLastTx = 0;
+    _directLinkSent = 0;
+    _directLinkReceived = 0;
+    _baudLoad = NULL;
+    _baudSave = NULL;
+    _storedBaud = 0;
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+    resetCommandStats();
+#endif
+#if LTE_SHIELD_ENABLE_TRACE
+    _traceEnabled = false;
+    traceClear();
+#endif
 }
 
 #ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
@@ -123,6 +334,7 @@ boolean LTE_Shield::begin(SoftwareSerial &softSerial, unsigned long baud)
     LTE_Shield_error_t err;
 
     _softSerial = &softSerial;
+    _serialPort = &softSerial;
 
     err = init(baud);
     if (err == LTE_SHIELD_ERROR_SUCCESS)
@@ -138,6 +350,7 @@ boolean LTE_Shield::begin(HardwareSerial &hardSerial, unsigned long baud)
     LTE_Shield_error_t err;
 
     _hardSerial = &hardSerial;
+    _serialPort = &hardSerial;
 
     err = init(baud);
     if (err == LTE_SHIELD_ERROR_SUCCESS)
@@ -147,108 +360,51 @@ boolean LTE_Shield::begin(HardwareSerial &hardSerial, unsigned long baud)
     return false;
 }
 
-boolean LTE_Shield::poll(void)
+boolean LTE_Shield::begin(Stream &stream, unsigned long baud)
 {
-    int avail = 0;
-    char c = 0;
-    bool handled = false;
+    LTE_Shield_error_t err;
 
-    memset(lteShieldRXBuffer, 0, 128);
+    _serialPort = &stream;
 
-    if (hwAvailable())
+    err = init(baud);
+    if (err == LTE_SHIELD_ERROR_SUCCESS)
     {
-        while (c != '\n')
-        {
-            if (hwAvailable())
-            {
-                c = readChar();
-                lteShieldRXBuffer[avail++] = c;
-            }
-        }
-        {
-            int socket, length;
-            if (sscanf(lteShieldRXBuffer, "+UUSORD: %d,%d", &socket, &length) == 2)
-            {
-                parseSocketReadIndication(socket, length);
-                handled = true;
-            }
-        }
-        {
-            int socket, listenSocket;
-            unsigned int port, listenPort;
-            IPAddress remoteIP, localIP;
+        return true;
+    }
+    return false;
+}
 
-            if (sscanf(lteShieldRXBuffer,
-                       "+UUSOLI: %d,\"%d.%d.%d.%d\",%u,%d,\"%d.%d.%d.%d\",%u",
-                       &socket,
-                       &remoteIP[0], &remoteIP[1], &remoteIP[2], &remoteIP[3],
-                       &port, &listenSocket,
-                       &localIP[0], &localIP[1], &localIP[2], &localIP[3],
-                       &listenPort) > 4)
-            {
-                parseSocketListenIndication(localIP, remoteIP);
-                handled = true;
-            }
-        }
-        {
-            int socket;
+boolean LTE_Shield::poll(void)
+{
+    boolean handled = false;
 
-            if (sscanf(lteShieldRXBuffer,
-                       "+UUSOCL: %d", &socket) == 1)
-            {
-                if ((socket >= 0) && (socket <= 6))
-                {
-                    if (_socketCloseCallback != NULL)
-                    {
-                        _socketCloseCallback(socket);
-                    }
-                }
-                handled = true;
-            }
-        }
-        {
-            ClockData clck;
-            PositionData gps;
-            SpeedData spd;
-            unsigned long uncertainty;
-            int scanNum;
-            unsigned int latH, lonH, altU, speedU, trackU;
-            char latL[10], lonL[10];
+    if (_directLink)
+        return false; // Everything on the UART is socket data
 
-            if (strstr(lteShieldRXBuffer, "+UULOC"))
-            {
-                // Found a Location string!
-                scanNum = sscanf(lteShieldRXBuffer,
-                                 "+UULOC: %hhu/%hhu/%u,%hhu:%hhu:%hhu.%u,%u.%[^,],%u.%[^,],%u,%lu,%u,%u,*%s",
-                                 &clck.date.day, &clck.date.month, &clck.date.year,
-                                 &clck.time.hour, &clck.time.minute, &clck.time.second, &clck.time.ms,
-                                 &latH, latL, &lonH, lonL, &altU, &uncertainty,
-                                 &speedU, &trackU);
-                if (scanNum < 13)
-                    return false; // Break out if we didn't find enough
-
-                gps.lat = (float)latH + ((float)atol(latL) / pow(10, strlen(latL)));
-                gps.lon = (float)lonH + ((float)atol(lonL) / pow(10, strlen(lonL)));
-                gps.alt = (float)altU;
-                if (scanNum == 15) // If detailed response, get speed data
-                {
-                    spd.speed = (float)speedU;
-                    spd.track = (float)trackU;
-                }
+    processCommands();
+    if (_activeCommand != NULL)
+    {
+        return false; // Anything waiting belongs to the command's response
+    }
 
-                if (_gpsRequestCallback != NULL)
-                {
-                    _gpsRequestCallback(clck, gps, spd, uncertainty);
-                }
-            }
-        }
+    // URCs that turned up while commands were running
+    handled = processUrcQueue();
 
-        if ((handled == false) && (strlen(lteShieldRXBuffer) > 2))
-        {
-            //Serial.println("Poll: " + String(lteShieldRXBuffer));
-        }
-        else
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    // Buffered socket writes that have waited long enough
+    flushDueSocketBuffers();
+#endif
+
+    // Only consume what has already arrived -- partial lines are kept for the next poll()
+    fillRxBuffer();
+    while ((_activeCommand == NULL) && (_rxHead != _rxTail))
+    {
+        if (assembleLine(rxRead()))
         {
+            if (processUrcLine(_rxLine))
+            {
+                handled = true;
+            }
         }
     }
     return handled;
@@ -259,374 +415,639 @@ void LTE_Shield::setSocketReadCallback(void (*socketReadCallback)(int, String))
     _socketReadCallback = socketReadCallback;
 }
 
+void LTE_Shield::setSocketDataCallback(void (*socketDataCallback)(int, const uint8_t *, size_t))
+{
+    _socketDataCallback = socketDataCallback;
+}
+
 void LTE_Shield::setSocketCloseCallback(void (*socketCloseCallback)(int))
 {
     _socketCloseCallback = socketCloseCallback;
 }
 
+void LTE_Shield::setSocketRecvFromCallback(void (*socketRecvFromCallback)(int, const uint8_t *, size_t,
+                                                                          IPAddress, unsigned int))
+{
+    _socketRecvFromCallback = socketRecvFromCallback;
+}
+
+void LTE_Shield::setSocketRecvFromBuffer(uint8_t *buffer, size_t size)
+{
+    // One byte is kept back for the NUL the String callback needs
+    _recvFromBuffer = (size > 1) ? buffer : NULL;
+    _recvFromBufferSize = (size > 1) ? size - 1 : 0;
+}
+
+void LTE_Shield::setSocketConnectCallback(void (*socketConnectCallback)(int, int, unsigned long))
+{
+    _socketConnectCallback = socketConnectCallback;
+}
+
+void LTE_Shield::setSleepCallback(void (*sleepCallback)(boolean asleep))
+{
+    _sleepCallback = sleepCallback;
+}
+
 void LTE_Shield::setGpsReadCallback(void (*gpsRequestCallback)(ClockData time,
                                                                PositionData gps, SpeedData spd, unsigned long uncertainty))
 {
     _gpsRequestCallback = gpsRequestCallback;
 }
 
-size_t LTE_Shield::write(uint8_t c)
+boolean LTE_Shield::setUrcHandler(const char *prefix, void (*urcHandler)(const char *params))
 {
-    if (_hardSerial != NULL)
+    int freeSlot = -1;
+
+    for (int i = 0; i < LTE_SHIELD_MAX_URC_HANDLERS; i++)
     {
-        return _hardSerial->write(c);
+        if ((_userUrcHandlers[i].handler != NULL) && (strcmp(_userUrcHandlers[i].prefix, prefix) == 0))
+        {
+            // Replace (or remove, if urcHandler is NULL) an existing handler
+            _userUrcHandlers[i].handler = urcHandler;
+            return true;
+        }
+        if ((_userUrcHandlers[i].handler == NULL) && (freeSlot < 0))
+        {
+            freeSlot = i;
+        }
     }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
+    if (urcHandler == NULL)
+        return true;
+    if (freeSlot < 0)
+        return false;
+
+    _userUrcHandlers[freeSlot].prefix = prefix;
+    _userUrcHandlers[freeSlot].handler = urcHandler;
+    return true;
+}
+
+size_t LTE_Shield::write(uint8_t c)
+{
+    if (_serialPort != NULL)
     {
-        return _softSerial->write(c);
+        return hwWrite(c);
     }
-#endif
     return (size_t)0;
 }
 
 size_t LTE_Shield::write(const char *str)
 {
-    if (_hardSerial != NULL)
-    {
-        return _hardSerial->print(str);
-    }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
+    if (_serialPort != NULL)
     {
-        return _softSerial->print(str);
+        return hwPrint(str);
     }
-#endif
     return (size_t)0;
 }
 
 size_t LTE_Shield::write(const char *buffer, size_t size)
 {
-    if (_hardSerial != NULL)
+    size_t written = 0;
+
+    if (_serialPort != NULL)
     {
-        return _hardSerial->print(buffer);
+        while ((written < size) && (hwWrite(buffer[written]) == 1))
+            written++;
     }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
-    {
-        return _softSerial->print(buffer);
+    return written;
+}
+
+LTE_Shield_command_status_t LTE_Shield::commandStatus(int handle)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = findCommand(handle);
+    if (cmd == NULL)
+        return LTE_SHIELD_COMMAND_STATUS_UNKNOWN;
+
+    switch (cmd->state)
+    {
+    case LTE_SHIELD_COMMAND_QUEUED:
+        return LTE_SHIELD_COMMAND_STATUS_QUEUED;
+    case LTE_SHIELD_COMMAND_WAIT_PROMPT:
+    case LTE_SHIELD_COMMAND_WAIT_RESPONSE:
+        return LTE_SHIELD_COMMAND_STATUS_ACTIVE;
+    case LTE_SHIELD_COMMAND_COMPLETE:
+        return LTE_SHIELD_COMMAND_STATUS_COMPLETE;
+    default:
+        return LTE_SHIELD_COMMAND_STATUS_UNKNOWN;
     }
-#endif
-    return (size_t)0;
 }
 
-LTE_Shield_error_t LTE_Shield::at(void)
+LTE_Shield_error_t LTE_Shield::commandResult(int handle)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    LTE_Shield_command_t *cmd;
 
-    err = sendCommandWithResponse(NULL, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+    if (handle < 0)
+        return (LTE_Shield_error_t)(-handle); // Command was never queued
 
-    return err;
+    cmd = findCommand(handle);
+    if ((cmd == NULL) || (cmd->state != LTE_SHIELD_COMMAND_COMPLETE))
+        return LTE_SHIELD_ERROR_INVALID;
+
+    return cmd->result;
 }
 
-LTE_Shield_error_t LTE_Shield::enableEcho(boolean enable)
+LTE_Shield_error_t LTE_Shield::waitForCommand(int handle)
 {
+    LTE_Shield_command_t *cmd;
     LTE_Shield_error_t err;
-    char *command;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_ECHO) + 2);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    if (enable)
-    {
-        sprintf(command, "%s1", LTE_SHIELD_COMMAND_ECHO);
-    }
-    else
+    if (handle < 0)
+        return (LTE_Shield_error_t)(-handle); // Command was never queued
+
+    cmd = findCommand(handle);
+    while ((cmd != NULL) && (cmd->state != LTE_SHIELD_COMMAND_COMPLETE))
     {
-        sprintf(command, "%s0", LTE_SHIELD_COMMAND_ECHO);
+        if (_asleep)
+        {
+            // The caller is waiting on this, so bring the modem out of PSM and watch for it waking
+            wake();
+            poll();
+        }
+        else
+        {
+            processCommands();
+        }
+        cmd = findCommand(handle);
     }
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  NULL, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    free(command);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_INVALID;
 
+    err = cmd->result;
+    cmd->state = LTE_SHIELD_COMMAND_FREE; // Result has been collected, recycle the slot
     return err;
 }
 
-String LTE_Shield::imei(void)
+uint8_t LTE_Shield::pendingCommands(void)
 {
-    char *response;
-    char imeiResponse[16];
-    LTE_Shield_error_t err;
+    uint8_t pending = 0;
 
-    response = lte_calloc_char(sizeof(imeiResponse) + 16);
-
-    err = sendCommandWithResponse(LTE_SHIELD_COMMAND_IMEI,
-                                  LTE_SHIELD_RESPONSE_OK, response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
+    for (int i = 0; i < LTE_SHIELD_MAX_PENDING_COMMANDS; i++)
     {
-        if (sscanf(response, "\r\n%s\r\n", imeiResponse) != 1)
+        if ((_commands[i].state != LTE_SHIELD_COMMAND_FREE) &&
+            (_commands[i].state != LTE_SHIELD_COMMAND_COMPLETE))
         {
-            memset(imeiResponse, 0, 16);
+            pending++;
         }
     }
-    free(response);
-    return String(imeiResponse);
-    ;
+    return pending;
 }
 
-String LTE_Shield::imsi(void)
+unsigned long LTE_Shield::droppedUrcs(void)
 {
-    char *response;
-    char imsiResponse[16];
-    LTE_Shield_error_t err;
+    return _droppedUrcs;
+}
 
-    response = lte_calloc_char(sizeof(imsiResponse) + 16);
+int LTE_Shield::lastErrorCode(void)
+{
+    return _lastErrorCode;
+}
 
-    err = sendCommandWithResponse(LTE_SHIELD_COMMAND_IMSI,
-                                  LTE_SHIELD_RESPONSE_OK, response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        if (sscanf(response, "\r\n%s\r\n", imsiResponse) != 1)
-        {
-            memset(imsiResponse, 0, 16);
-        }
-    }
-    free(response);
-    return String(imsiResponse);
+struct InitStats LTE_Shield::initStats(void)
+{
+    return _initStats;
 }
 
-String LTE_Shield::ccid(void)
+void LTE_Shield::setBaudStore(LTE_Shield_baud_load_t load, LTE_Shield_baud_save_t save)
 {
-    char *response;
-    char ccidResponse[21];
-    LTE_Shield_error_t err;
+    _baudLoad = load;
+    _baudSave = save;
+}
 
-    response = lte_calloc_char(sizeof(ccidResponse) + 16);
+#ifdef ARDUINO_ARCH_AVR
+void LTE_Shield::setBaudStoreEeprom(int address)
+{
+    _baudEepromAddress = address;
+    setBaudStore(loadBaudEeprom, saveBaudEeprom);
+}
+#endif
 
-    err = sendCommandWithResponse(LTE_SHIELD_COMMAND_CCID,
-                                  LTE_SHIELD_RESPONSE_OK, response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+const struct CommandStats *LTE_Shield::commandStats(uint8_t *verbs)
+{
+    if (verbs != NULL)
     {
-        if (sscanf(response, "\r\n+CCID: %s", ccidResponse) != 1)
-        {
-            memset(ccidResponse, 0, 21);
-        }
+        *verbs = _commandStatsUsed;
     }
-    free(response);
-    return String(ccidResponse);
+    return _commandStats;
 }
 
-LTE_Shield_error_t LTE_Shield::reset(void)
+void LTE_Shield::resetCommandStats(void)
 {
-    LTE_Shield_error_t err;
+    memset(_commandStats, 0, sizeof(_commandStats));
+    _commandStatsUsed = 0;
+}
 
-    err = functionality(SILENT_RESET);
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        // Reset will set the baud rate back to 115200
-        //beginSerial(9600);
-        err = LTE_SHIELD_ERROR_INVALID;
-        while (err != LTE_SHIELD_ERROR_SUCCESS)
+void LTE_Shield::printCommandStats(Print &out)
+{
+    for (uint8_t i = 0; i < _commandStatsUsed; i++)
+    {
+        struct CommandStats *stats = &_commandStats[i];
+        int lastBucket = LTE_SHIELD_STATS_BUCKETS - 1;
+
+        // Trailing empty buckets are left off
+        while ((lastBucket > 0) && (stats->histogram[lastBucket] == 0))
+            lastBucket--;
+
+        out.print((stats->verb[0] != '\0') ? stats->verb : "AT");
+        out.print(F(" n="));
+        out.print(stats->count);
+        out.print(F(" min="));
+        out.print(stats->minLatency);
+        out.print(F(" avg="));
+        out.print((stats->count > 0) ? stats->totalLatency / stats->count : 0);
+        out.print(F(" max="));
+        out.print(stats->maxLatency);
+        out.print(F(" to="));
+        out.print(stats->timeouts);
+        out.print(F(" err="));
+        out.print(stats->errors);
+        out.print(F(" h="));
+        for (int b = 0; b <= lastBucket; b++)
         {
-            beginSerial(LTE_SHIELD_DEFAULT_BAUD_RATE);
-            setBaud(_baud);
-            delay(200);
-            beginSerial(_baud);
-            err = at();
-            delay(500);
+            if (b > 0)
+                out.print(',');
+            out.print(stats->histogram[b]);
         }
-        return init(_baud);
+        out.println();
     }
-    return err;
 }
 
-String LTE_Shield::clock(void)
+void LTE_Shield::recordCommandStats(LTE_Shield_command_t *cmd, LTE_Shield_error_t err)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    char *clockBegin;
-    char *clockEnd;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_CLOCK) + 2);
-    if (command == NULL)
-        return "";
-    sprintf(command, "%s?", LTE_SHIELD_COMMAND_CLOCK);
-
-    response = lte_calloc_char(48);
-    if (response == NULL)
+    char verb[sizeof(_commandStats[0].verb)];
+    size_t verbLength = 0;
+    struct CommandStats *stats = NULL;
+    unsigned long latency = millis() - cmd->sentTime;
+    int bucket = 0;
+
+    // Extended commands are named up to their first non-alphanumeric ("+CSQ", "+USOWR"),
+    // basic ones by their letter ("E", "D")
+    if (cmd->command[0] == '+')
+    {
+        verb[verbLength++] = '+';
+        while ((verbLength < sizeof(verb) - 1) && isalnum(cmd->command[verbLength]))
+        {
+            verb[verbLength] = cmd->command[verbLength];
+            verbLength++;
+        }
+    }
+    else if (cmd->command[0] != '\0')
     {
-        free(command);
-        return "";
+        verb[verbLength++] = cmd->command[0];
     }
+    verb[verbLength] = '\0';
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
+    for (uint8_t i = 0; i < _commandStatsUsed; i++)
+    {
+        if (strcmp(_commandStats[i].verb, verb) == 0)
+        {
+            stats = &_commandStats[i];
+            break;
+        }
+    }
+    if (stats == NULL)
     {
-        free(command);
-        free(response);
-        return "";
+        if (_commandStatsUsed >= LTE_SHIELD_STATS_VERBS)
+            return; // Table full
+        stats = &_commandStats[_commandStatsUsed++];
+        strcpy(stats->verb, verb);
+        stats->minLatency = latency;
     }
 
-    // Response format: \r\n+CCLK: "YY/MM/DD,HH:MM:SS-TZ"\r\n\r\nOK\r\n
-    clockBegin = strchr(response, '\"'); // Find first quote
-    if (clockBegin == NULL)
+    stats->count++;
+    stats->totalLatency += latency;
+    if (latency < stats->minLatency)
+        stats->minLatency = latency;
+    if (latency > stats->maxLatency)
+        stats->maxLatency = latency;
+    while ((bucket < LTE_SHIELD_STATS_BUCKETS - 1) && ((1UL << bucket) <= latency))
+        bucket++;
+    stats->histogram[bucket]++;
+
+    if ((err == LTE_SHIELD_ERROR_NO_RESPONSE) ||
+        ((err == LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE) && (latency >= cmd->timeout)))
     {
-        free(command);
-        free(response);
-        return "";
+        stats->timeouts++;
     }
-    clockBegin += 1;                     // Increment pointer to begin at first number
-    clockEnd = strchr(clockBegin, '\"'); // Find last quote
-    if (clockEnd == NULL)
+    else if (err != LTE_SHIELD_ERROR_SUCCESS)
     {
-        free(command);
-        free(response);
-        return "";
+        stats->errors++;
     }
-    *(clockEnd) = '\0'; // Set last quote to null char -- end string
-
-    free(command);
-    free(response);
+}
+#endif
 
-    return String(clockBegin);
+LTE_Shield_error_t LTE_Shield::at(void)
+{
+    return waitForCommand(atAsync());
 }
 
-LTE_Shield_error_t LTE_Shield::clock(uint8_t *y, uint8_t *mo, uint8_t *d,
-                                     uint8_t *h, uint8_t *min, uint8_t *s, uint8_t *tz)
+int LTE_Shield::atAsync(LTE_Shield_command_callback_t callback)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    char *clockBegin;
-    char *clockEnd;
+    LTE_Shield_command_t *cmd;
 
-    int iy, imo, id, ih, imin, is, itz;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_CLOCK) + 2);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s?", LTE_SHIELD_COMMAND_CLOCK);
+    return submitCommand(cmd);
+}
 
-    response = lte_calloc_char(48);
-    if (response == NULL)
-    {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
+LTE_Shield_error_t LTE_Shield::enableEcho(boolean enable)
+{
+    return waitForCommand(enableEchoAsync(enable));
+}
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+int LTE_Shield::enableEchoAsync(boolean enable, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
-    // Response format: \r\n+CCLK: "YY/MM/DD,HH:MM:SS-TZ"\r\n\r\nOK\r\n
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        if (sscanf(response, "\r\n+CCLK: \"%d/%d/%d,%d:%d:%d-%d\"\r\n",
-                   &iy, &imo, &id, &ih, &imin, &is, &itz) == 7)
-        {
-            *y = iy;
-            *mo = imo;
-            *d = id;
-            *h = ih;
-            *min = imin;
-            *s = is;
-            *tz = itz;
-        }
-    }
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_ECHO);
+    appendCommandInt(cmd, enable ? 1 : 0);
 
-    free(command);
-    free(response);
-    return err;
+    return submitCommand(cmd);
 }
 
-LTE_Shield_error_t LTE_Shield::autoTimeZone(boolean enable)
+LTE_Shield_error_t LTE_Shield::enableErrorCodes(boolean enable)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    return waitForCommand(enableErrorCodesAsync(enable));
+}
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_AUTO_TZ) + 3);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d", LTE_SHIELD_COMMAND_AUTO_TZ, enable ? 1 : 0);
+int LTE_Shield::enableErrorCodesAsync(boolean enable, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  NULL, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-    free(command);
-    return err;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_CMEE);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, enable ? 1 : 0); // Numeric codes, so they fit in lastErrorCode()
+
+    return submitCommand(cmd);
 }
 
-int8_t LTE_Shield::rssi(void)
+String LTE_Shield::imei(void)
 {
-    char *command;
-    char *response;
-    LTE_Shield_error_t err;
-    int rssi;
+    String imei;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_SIGNAL_QUALITY) + 1);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s", LTE_SHIELD_SIGNAL_QUALITY);
+    waitForCommand(imeiAsync(&imei));
+    return imei;
+}
 
-    response = lte_calloc_char(48);
-    if (response == NULL)
-    {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
+int LTE_Shield::imeiAsync(String *imei, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
-    err = sendCommandWithResponse(command,
-                                  LTE_SHIELD_RESPONSE_OK, response, 10000, AT_COMMAND);
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
-    {
-        free(command);
-        free(response);
-        return -1;
-    }
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_IMEI);
+    cmd->parser = parseIdentityResponse;
+    cmd->results[0] = imei;
 
-    if (sscanf(response, "\r\n+CSQ: %d,%*d", &rssi) != 1)
-    {
-        rssi = -1;
-    }
+    return submitCommand(cmd);
+}
 
-    free(command);
-    free(response);
-    return rssi;
+String LTE_Shield::imsi(void)
+{
+    String imsi;
+
+    waitForCommand(imsiAsync(&imsi));
+    return imsi;
 }
 
-LTE_Shield_registration_status_t LTE_Shield::registration(void)
+int LTE_Shield::imsiAsync(String *imsi, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_IMSI);
+    cmd->parser = parseIdentityResponse;
+    cmd->results[0] = imsi;
+
+    return submitCommand(cmd);
+}
+
+String LTE_Shield::ccid(void)
+{
+    String ccid;
+
+    waitForCommand(ccidAsync(&ccid));
+    return ccid;
+}
+
+int LTE_Shield::ccidAsync(String *ccid, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_CCID);
+    cmd->parser = parseCcidResponse;
+    cmd->results[0] = ccid;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::reset(void)
 {
-    char *command;
-    char *response;
     LTE_Shield_error_t err;
-    int status;
+    struct RecoveryResult result;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_REGISTRATION_STATUS) + 2);
-    if (command == NULL)
-        return LTE_SHIELD_REGISTRATION_INVALID;
-    sprintf(command, "%s?", LTE_SHIELD_REGISTRATION_STATUS);
+    err = functionality(SILENT_RESET);
+    if (err == LTE_SHIELD_ERROR_SUCCESS)
+    {
+        if (!waitForModem(LTE_SHIELD_SILENT_RESET_BUDGET, true, &result))
+            return LTE_SHIELD_ERROR_NO_RESPONSE;
+        _freshBoot = true;
+        return init(_baud);
+    }
+    return err;
+}
 
-    response = lte_calloc_char(48);
-    if (response == NULL)
+struct RecoveryResult LTE_Shield::recover(void)
+{
+    struct RecoveryResult result;
+    unsigned long start = millis();
+    boolean answered;
+
+    result.tier = LTE_SHIELD_RECOVERY_FAILED;
+    result.pings = 0;
+    result.duration = 0;
+
+    // Nothing to recover to without the port and baud rate begin() sets up
+    if ((_serialPort == NULL) || (_baud == 0))
+        return result;
+
+    // No soft reset step: a modem that hasn't answered "AT" won't answer AT+CFUN either
+    result.tier = LTE_SHIELD_RECOVERY_AT;
+    answered = waitForModem(LTE_SHIELD_RECOVERY_AT_BUDGET, false, &result);
+    if (!answered)
+    {
+        result.tier = LTE_SHIELD_RECOVERY_HW_RESET;
+        hwReset();
+        answered = waitForModem(LTE_SHIELD_RECOVERY_HW_RESET_BUDGET, true, &result);
+    }
+    if (!answered)
     {
-        free(command);
-        return LTE_SHIELD_REGISTRATION_INVALID;
+        // Don't know if it's on or off, so one pulse may only have turned it off
+        result.tier = LTE_SHIELD_RECOVERY_POWER_CYCLE;
+        for (int pulse = 0; (pulse < 2) && !answered; pulse++)
+        {
+            powerOn();
+            answered = waitForModem(LTE_SHIELD_RECOVERY_POWER_BUDGET, true, &result);
+        }
     }
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, AT_COMMAND);
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
+    if (!answered)
     {
-        free(command);
-        free(response);
-        return LTE_SHIELD_REGISTRATION_INVALID;
+        result.tier = LTE_SHIELD_RECOVERY_FAILED;
+    }
+    else if (result.tier != LTE_SHIELD_RECOVERY_AT)
+    {
+        // It rebooted, so echo, error reporting, etc. need setting again
+        _freshBoot = true;
+        if (init(_baud) != LTE_SHIELD_ERROR_SUCCESS)
+            result.tier = LTE_SHIELD_RECOVERY_FAILED;
     }
+    result.duration = millis() - start;
+    return result;
+}
 
-    if (sscanf(response, "\r\n+CREG: %*d,%d", &status) != 1)
+String LTE_Shield::clock(void)
+{
+    String clock;
+
+    waitForCommand(clockAsync(&clock));
+    return clock;
+}
+
+int LTE_Shield::clockAsync(String *clock, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_CLOCK);
+    appendCommand(cmd, '?');
+    cmd->parser = parseClockStringResponse;
+    cmd->results[0] = clock;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::clock(uint8_t *y, uint8_t *mo, uint8_t *d,
+                                     uint8_t *h, uint8_t *min, uint8_t *s, uint8_t *tz)
+{
+    LTE_Shield_error_t err;
+    struct ClockData clk;
+
+    err = waitForCommand(clockAsync(&clk));
+    if (err == LTE_SHIELD_ERROR_SUCCESS)
     {
-        status = LTE_SHIELD_REGISTRATION_INVALID;
+        *y = clk.date.year;
+        *mo = clk.date.month;
+        *d = clk.date.day;
+        *h = clk.time.hour;
+        *min = clk.time.minute;
+        *s = clk.time.second;
+        *tz = clk.time.tzh;
+    }
+    return err;
+}
+
+int LTE_Shield::clockAsync(struct ClockData *clk, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_CLOCK);
+    appendCommand(cmd, '?');
+    cmd->parser = parseClockResponse;
+    cmd->results[0] = clk;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::autoTimeZone(boolean enable)
+{
+    return waitForCommand(autoTimeZoneAsync(enable));
+}
+
+int LTE_Shield::autoTimeZoneAsync(boolean enable, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_AUTO_TZ);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, enable ? 1 : 0);
+
+    return submitCommand(cmd);
+}
+
+int8_t LTE_Shield::rssi(void)
+{
+    int8_t rssi = -1;
+
+    if (waitForCommand(rssiAsync(&rssi)) != LTE_SHIELD_ERROR_SUCCESS)
+    {
+        return -1;
+    }
+    return rssi;
+}
+
+int LTE_Shield::rssiAsync(int8_t *rssi, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 10000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_SIGNAL_QUALITY);
+    cmd->parser = parseRssiResponse;
+    cmd->results[0] = rssi;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_registration_status_t LTE_Shield::registration(void)
+{
+    LTE_Shield_registration_status_t status = LTE_SHIELD_REGISTRATION_INVALID;
+
+    if (waitForCommand(registrationAsync(&status)) != LTE_SHIELD_ERROR_SUCCESS)
+    {
+        return LTE_SHIELD_REGISTRATION_INVALID;
     }
-    free(command);
-    free(response);
-    return (LTE_Shield_registration_status_t)status;
+    return status;
+}
+
+int LTE_Shield::registrationAsync(LTE_Shield_registration_status_t *status,
+                                  LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_REGISTRATION_STATUS);
+    appendCommand(cmd, '?');
+    cmd->parser = parseRegistrationResponse;
+    cmd->results[0] = status;
+
+    return submitCommand(cmd);
 }
 
 boolean LTE_Shield::setNetwork(mobile_network_operator_t mno)
@@ -674,118 +1095,86 @@ mobile_network_operator_t LTE_Shield::getNetwork(void)
     return mno;
 }
 
+int LTE_Shield::getNetworkAsync(mobile_network_operator_t *mno, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_MNO);
+    appendCommand(cmd, '?');
+    cmd->parser = parseMnoResponse;
+    cmd->results[0] = mno;
+
+    return submitCommand(cmd);
+}
+
 LTE_Shield_error_t LTE_Shield::setAPN(String apn, uint8_t cid, LTE_Shield_pdp_type pdpType)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char pdpStr[8];
+    return waitForCommand(setAPNAsync(apn.c_str(), cid, pdpType));
+}
 
-    memset(pdpStr, 0, 8);
+int LTE_Shield::setAPNAsync(const char *apn, uint8_t cid, LTE_Shield_pdp_type pdpType,
+                            LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+    const char *pdpStr;
 
     if (cid >= 8)
-        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_MESSAGE_PDP_DEF) + strlen(apn.c_str()) + 16);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
     switch (pdpType)
     {
-    case PDP_TYPE_INVALID:
-        free(command);
-        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
-        break;
     case PDP_TYPE_IP:
-        memcpy(pdpStr, "IP", 2);
+        pdpStr = "IP";
         break;
     case PDP_TYPE_NONIP:
-        memcpy(pdpStr, "NONIP", 2);
+        pdpStr = "NONIP";
         break;
     case PDP_TYPE_IPV4V6:
-        memcpy(pdpStr, "IPV4V6", 2);
+        pdpStr = "IPV4V6";
         break;
     case PDP_TYPE_IPV6:
-        memcpy(pdpStr, "IPV6", 2);
+        pdpStr = "IPV6";
         break;
+    default:
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
     }
-    sprintf(command, "%s=%d,\"%s\",\"%s\"", LTE_SHIELD_MESSAGE_PDP_DEF,
-            cid, pdpStr, apn.c_str());
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    free(command);
-
-    return err;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_MESSAGE_PDP_DEF);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, cid);
+    appendCommand(cmd, ',');
+    appendCommandQuoted(cmd, pdpStr);
+    appendCommand(cmd, ',');
+    appendCommandQuoted(cmd, apn);
+
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::getAPN(String *apn, IPAddress *ip)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    char *searchPtr;
-    int ipOctets[4];
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_MESSAGE_PDP_DEF) + 3);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s?", LTE_SHIELD_MESSAGE_PDP_DEF);
-
-    response = lte_calloc_char(128);
-    if (response == NULL)
-    {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
-
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, response,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        // Example: +CGDCONT: 1,"IP","hologram","10.170.241.191",0,0,0,0
-        searchPtr = strstr(response, "+CGDCONT: ");
-        if (searchPtr != NULL)
-        {
-            searchPtr += strlen("+CGDCONT: ");
-            // Search to the third double-quote
-            for (int i = 0; i < 3; i++)
-            {
-                searchPtr = strchr(++searchPtr, '\"');
-            }
-            if (searchPtr != NULL)
-            {
-                // Fill in the APN:
-                searchPtr = strchr(searchPtr, '\"'); // Move to first quote
-                while ((*(++searchPtr) != '\"') && (*searchPtr != '\0'))
-                {
-                    apn->concat(*(searchPtr));
-                }
-                // Now get the IP:
-                if (searchPtr != NULL)
-                {
-                    int scanned = sscanf(searchPtr, "\",\"%d.%d.%d.%d\"",
-                                         &ipOctets[0], &ipOctets[1], &ipOctets[2], &ipOctets[3]);
-                    if (scanned == 4)
-                    {
-                        for (int octet = 0; octet < 4; octet++)
-                        {
-                            (*ip)[octet] = (uint8_t)ipOctets[octet];
-                        }
-                    }
-                }
-            }
-        }
-        else
-        {
-            err = LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
-        }
-    }
-
-    free(command);
-    free(response);
+    return waitForCommand(getAPNAsync(apn, ip));
+}
 
-    return err;
+int LTE_Shield::getAPNAsync(String *apn, IPAddress *ip, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_MESSAGE_PDP_DEF);
+    appendCommand(cmd, '?');
+    cmd->parser = parseApnResponse;
+    cmd->results[0] = apn;
+    cmd->results[1] = ip;
+
+    return submitCommand(cmd);
 }
 
 const char *PPP_L2P[5] = {
@@ -799,472 +1188,415 @@ const char *PPP_L2P[5] = {
 LTE_Shield_error_t LTE_Shield::enterPPP(uint8_t cid, char dialing_type_char,
                                         unsigned long dialNumber, LTE_Shield::LTE_Shield_l2p_t l2p)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    return waitForCommand(enterPPPAsync(cid, dialing_type_char, dialNumber, l2p));
+}
+
+int LTE_Shield::enterPPPAsync(uint8_t cid, char dialing_type_char,
+                              unsigned long dialNumber, LTE_Shield::LTE_Shield_l2p_t l2p,
+                              LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
     if ((dialing_type_char != 0) && (dialing_type_char != 'T') &&
         (dialing_type_char != 'P'))
     {
-        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
     }
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_MESSAGE_ENTER_PPP) + 32);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_MESSAGE_ENTER_PPP);
     if (dialing_type_char != 0)
     {
-        sprintf(command, "%s%c*%lu**%s*%hhu#", LTE_SHIELD_MESSAGE_ENTER_PPP, dialing_type_char,
-                dialNumber, PPP_L2P[l2p], cid);
-    }
-    else
-    {
-        sprintf(command, "%s*%lu**%s*%hhu#", LTE_SHIELD_MESSAGE_ENTER_PPP,
-                dialNumber, PPP_L2P[l2p], cid);
+        appendCommand(cmd, dialing_type_char);
     }
-
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    free(command);
-    return err;
+    appendCommand(cmd, '*');
+    appendCommandUnsigned(cmd, dialNumber);
+    appendCommand(cmd, "**");
+    appendCommand(cmd, PPP_L2P[l2p]);
+    appendCommand(cmd, '*');
+    appendCommandUnsigned(cmd, cid);
+    appendCommand(cmd, '#');
+
+    return submitCommand(cmd);
 }
 
 uint8_t LTE_Shield::getOperators(struct operator_stats *opRet, int maxOps)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
     uint8_t opsSeen = 0;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_OPERATOR_SELECTION) + 3);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=?", LTE_SHIELD_OPERATOR_SELECTION);
+    waitForCommand(getOperatorsAsync(opRet, &opsSeen, maxOps));
+    return opsSeen;
+}
 
-    response = lte_calloc_char(maxOps * 48 + 16);
-    if (response == NULL)
-    {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
+int LTE_Shield::getOperatorsAsync(struct operator_stats *opRet, uint8_t *opsSeen, int maxOps,
+                                  LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
     // AT+COPS maximum response time is 3 minutes (180000 ms)
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, response,
-                                  180000);
-
-    // Sample responses:
-    // +COPS: (3,"Verizon Wireless","VzW","311480",8),,(0,1,2,3,4),(0,1,2)
-    // +COPS: (1,"313 100","313 100","313100",8),(2,"AT&T","AT&T","310410",8),(3,"311 480","311 480","311480",8),,(0,1,2,3,4),(0,1,2)
-
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        char *opBegin;
-        char *opEnd;
-        int op = 0;
-        int sscanRead = 0;
-        int stat;
-        char longOp[26];
-        char shortOp[11];
-        int act;
-        unsigned long numOp;
-
-        opBegin = response;
-
-        for (; op < maxOps; op++)
-        {
-            opBegin = strchr(opBegin, '(');
-            if (opBegin == NULL)
-                break;
-            opEnd = strchr(opBegin, ')');
-            if (opEnd == NULL)
-                break;
-
-            int sscanRead = sscanf(opBegin, "(%d,\"%[^\"]\",\"%[^\"]\",\"%lu\",%d)%*s",
-                                   &stat, longOp, shortOp, &numOp, &act);
-            if (sscanRead == 5)
-            {
-                opRet[op].stat = stat;
-                opRet[op].longOp = (String)(longOp);
-                opRet[op].shortOp = (String)(shortOp);
-                opRet[op].numOp = numOp;
-                opRet[op].act = act;
-                opsSeen += 1;
-            }
-            // TODO: Search for other possible patterns here
-            else
-            {
-                break; // Break out if pattern doesn't match.
-            }
-            opBegin = opEnd + 1; // Move opBegin to beginning of next value
-        }
-    }
-
-    free(command);
-    free(response);
-
-    return opsSeen;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 180000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_OPERATOR_SELECTION);
+    appendCommand(cmd, "=?");
+
+    // The list can be far longer than the response buffer, so parse one
+    // (stat,"long","short","numeric",act) entry at a time as it arrives
+    *opsSeen = 0;
+    cmd->recordParser = parseOperatorRecord;
+    cmd->recordDelimiter = ')';
+    cmd->results[0] = opRet;
+    cmd->results[1] = opsSeen;
+    cmd->resultArg = maxOps;
+
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::registerOperator(struct operator_stats oper)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    return waitForCommand(registerOperatorAsync(oper));
+}
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_OPERATOR_SELECTION) + 24);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=1,2,\"%lu\"", LTE_SHIELD_OPERATOR_SELECTION, oper.numOp);
+int LTE_Shield::registerOperatorAsync(struct operator_stats oper, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
     // AT+COPS maximum response time is 3 minutes (180000 ms)
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  180000);
-
-    free(command);
-    return err;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 180000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_OPERATOR_SELECTION);
+    appendCommand(cmd, "=1,2,\"");
+    appendCommandUnsigned(cmd, oper.numOp);
+    appendCommand(cmd, '\"');
+
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::getOperator(String *oper)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    char *searchPtr;
-    char mode;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_OPERATOR_SELECTION) + 3);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s?", LTE_SHIELD_OPERATOR_SELECTION);
+    return waitForCommand(getOperatorAsync(oper));
+}
 
-    response = lte_calloc_char(64);
-    if (response == NULL)
-    {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
+int LTE_Shield::getOperatorAsync(String *oper, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
     // AT+COPS maximum response time is 3 minutes (180000 ms)
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, response,
-                                  180000);
-
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        searchPtr = strstr(response, "+COPS: ");
-        if (searchPtr != NULL)
-        {
-            searchPtr += strlen("+COPS: "); //  Move searchPtr to first char
-            mode = *searchPtr;              // Read first char -- should be mode
-            if (mode == '2')                // Check for de-register
-            {
-                err = LTE_SHIELD_ERROR_DEREGISTERED;
-            }
-            // Otherwise if it's default, manual, set-only, or automatic
-            else if ((mode == '0') || (mode == '1') || (mode == '3') || (mode == '4'))
-            {
-                *oper = "";
-                searchPtr = strchr(searchPtr, '\"'); // Move to first quote
-                if (searchPtr == NULL)
-                {
-                    err = LTE_SHIELD_ERROR_DEREGISTERED;
-                }
-                else
-                {
-                    while ((*(++searchPtr) != '\"') && (*searchPtr != '\0'))
-                    {
-                        oper->concat(*(searchPtr));
-                    }
-                }
-                //Serial.println("Operator: " + *oper);
-                //oper->concat('\0');
-            }
-        }
-    }
-
-    free(response);
-    free(command);
-    return err;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 180000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_OPERATOR_SELECTION);
+    appendCommand(cmd, '?');
+    cmd->parser = parseOperatorResponse;
+    cmd->results[0] = oper;
+
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::deregisterOperator(void)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    return waitForCommand(deregisterOperatorAsync());
+}
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_OPERATOR_SELECTION) + 4);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=2", LTE_SHIELD_OPERATOR_SELECTION);
+int LTE_Shield::deregisterOperatorAsync(LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_OPERATOR_SELECTION);
+    appendCommand(cmd, "=2");
 
-    free(command);
-    return err;
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::setSMSMessageFormat(lte_shield_message_format_t textMode)
 {
-    char *command;
-    LTE_Shield_error_t err;
+    return waitForCommand(setSMSMessageFormatAsync(textMode));
+}
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_MESSAGE_FORMAT) + 4);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d", LTE_SHIELD_MESSAGE_FORMAT,
-            (textMode == LTE_SHIELD_MESSAGE_FORMAT_TEXT) ? 1 : 0);
+int LTE_Shield::setSMSMessageFormatAsync(lte_shield_message_format_t textMode,
+                                         LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_MESSAGE_FORMAT);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, (textMode == LTE_SHIELD_MESSAGE_FORMAT_TEXT) ? 1 : 0);
 
-    free(command);
-    return err;
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::sendSMS(String number, String message)
 {
-    char *command;
-    char *messageCStr;
-    char *numberCStr;
-    int messageIndex;
-    LTE_Shield_error_t err;
+    return waitForCommand(sendSMSAsync(number.c_str(), message.c_str()));
+}
 
-    numberCStr = lte_calloc_char(number.length() + 2);
-    if (numberCStr == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    number.toCharArray(numberCStr, number.length() + 1);
+int LTE_Shield::sendSMSAsync(const char *number, const char *message,
+                             LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 180000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_SEND_TEXT);
+    appendCommand(cmd, '=');
+    appendCommandQuoted(cmd, number);
+
+    // Message is sent after the '>' prompt and terminated with CTRL+Z
+    cmd->prompt = ">";
+    cmd->payload = message;
+    cmd->payloadLength = strlen(message);
+    cmd->payloadTerminator = ASCII_CTRL_Z;
+
+    return submitCommand(cmd);
+}
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_SEND_TEXT) + strlen(numberCStr) + 8);
-    if (command != NULL)
+LTE_Shield_error_t LTE_Shield::setBaud(unsigned long baud)
+{
+    return waitForCommand(setBaudAsync(baud));
+}
+
+int LTE_Shield::setBaudAsync(unsigned long baud, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    // Error check -- ensure supported baud
+    if (!supportedBaud(baud))
     {
-        sprintf(command, "%s=\"%s\"", LTE_SHIELD_SEND_TEXT, numberCStr);
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+    }
 
-        err = sendCommandWithResponse(command, ">", NULL,
-                                      LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-        free(command);
-        free(numberCStr);
-        if (err != LTE_SHIELD_ERROR_SUCCESS)
-            return err;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_SET_BAUD_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_BAUD);
+    appendCommand(cmd, '=');
+    appendCommandUnsigned(cmd, baud);
 
-        messageCStr = lte_calloc_char(message.length() + 1);
-        if (messageCStr == NULL)
-        {
-            hwWrite(ASCII_CTRL_Z);
-            return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-        }
-        message.toCharArray(messageCStr, message.length() + 1);
-        messageCStr[message.length()] = ASCII_CTRL_Z;
-
-        err = sendCommandWithResponse(messageCStr, LTE_SHIELD_RESPONSE_OK,
-                                      NULL, 180000, NOT_AT_COMMAND);
-
-        free(messageCStr);
-    }
-    else
-    {
-        free(numberCStr);
-        err = LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
-
-    return err;
+    return submitCommand(cmd);
 }
 
-LTE_Shield_error_t LTE_Shield::setBaud(unsigned long baud)
+LTE_Shield_error_t LTE_Shield::setGpioMode(LTE_Shield_gpio_t gpio,
+                                           LTE_Shield_gpio_mode_t mode)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    int b = 0;
-
-    // Error check -- ensure supported baud
-    for (; b < NUM_SUPPORTED_BAUD; b++)
-    {
-        if (LTE_SHIELD_SUPPORTED_BAUD[b] == baud)
-        {
-            break;
-        }
-    }
-    if (b >= NUM_SUPPORTED_BAUD)
-    {
-        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
-    }
-
-    // Construct command
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_BAUD) + 7 + 12);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%lu", LTE_SHIELD_COMMAND_BAUD, baud);
-
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  NULL, LTE_SHIELD_SET_BAUD_TIMEOUT);
-
-    free(command);
-
-    return err;
+    return waitForCommand(setGpioModeAsync(gpio, mode));
 }
 
-LTE_Shield_error_t LTE_Shield::setGpioMode(LTE_Shield_gpio_t gpio,
-                                           LTE_Shield_gpio_mode_t mode)
+int LTE_Shield::setGpioModeAsync(LTE_Shield_gpio_t gpio, LTE_Shield_gpio_mode_t mode,
+                                 LTE_Shield_command_callback_t callback)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    LTE_Shield_command_t *cmd;
 
     // Example command: AT+UGPIOC=16,2
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_GPIO) + 7);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d,%d", LTE_SHIELD_COMMAND_GPIO, gpio, mode);
-
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  NULL, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    free(command);
-
-    return err;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_GPIO);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, gpio);
+    appendCommand(cmd, ',');
+    appendCommandInt(cmd, mode);
+
+    return submitCommand(cmd);
 }
 
 LTE_Shield::LTE_Shield_gpio_mode_t LTE_Shield::getGpioMode(LTE_Shield_gpio_t gpio)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    char gpioChar[4];
-    char *gpioStart;
-    int gpioMode;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_GPIO) + 2);
-    if (command == NULL)
-        return GPIO_MODE_INVALID;
-    sprintf(command, "%s?", LTE_SHIELD_COMMAND_GPIO);
-
-    response = lte_calloc_char(96);
-    if (response == NULL)
-    {
-        free(command);
-        return GPIO_MODE_INVALID;
-    }
+    LTE_Shield_gpio_mode_t mode = GPIO_MODE_INVALID;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
+    if (waitForCommand(getGpioModeAsync(gpio, &mode)) != LTE_SHIELD_ERROR_SUCCESS)
     {
-        free(command);
-        free(response);
         return GPIO_MODE_INVALID;
     }
+    return mode;
+}
 
-    sprintf(gpioChar, "%d", gpio);          // Convert GPIO to char array
-    gpioStart = strstr(response, gpioChar); // Find first occurence of GPIO in response
-
-    free(command);
-    free(response);
-
-    if (gpioStart == NULL)
-        return GPIO_MODE_INVALID; // If not found return invalid
-    sscanf(gpioStart, "%*d,%d\r\n", &gpioMode);
-
-    return (LTE_Shield_gpio_mode_t)gpioMode;
+int LTE_Shield::getGpioModeAsync(LTE_Shield_gpio_t gpio, LTE_Shield_gpio_mode_t *mode,
+                                 LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_GPIO);
+    appendCommand(cmd, '?');
+    cmd->parser = parseGpioModeResponse;
+    cmd->results[0] = mode;
+    cmd->resultArg = gpio;
+
+    return submitCommand(cmd);
 }
 
 int LTE_Shield::socketOpen(lte_shield_socket_protocol_t protocol, unsigned int localPort)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
     int sockId = -1;
-    char *responseStart;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_CREATE_SOCKET) + 10);
-    if (command == NULL)
-        return -1;
-    sprintf(command, "%s=%d,%d", LTE_SHIELD_CREATE_SOCKET, protocol, localPort);
 
-    response = lte_calloc_char(24);
-    if (response == NULL)
+    if (waitForCommand(socketOpenAsync(protocol, &sockId, localPort)) != LTE_SHIELD_ERROR_SUCCESS)
     {
-        free(command);
         return -1;
     }
+    return sockId;
+}
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+int LTE_Shield::socketOpenAsync(lte_shield_socket_protocol_t protocol, int *socket,
+                                unsigned int localPort, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_CREATE_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, protocol);
+    appendCommand(cmd, ',');
+    appendCommandUnsigned(cmd, localPort);
+    cmd->parser = parseSocketOpenResponse;
+    cmd->results[0] = socket;
+    cmd->results[1] = _socketFlags; // Cleared for whichever socket the modem hands out
+    cmd->results[2] = _socketUnread;
+
+    return submitCommand(cmd);
+}
 
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
-    {
-        free(command);
-        free(response);
-        return -1;
-    }
+LTE_Shield_error_t LTE_Shield::socketClose(int socket, int timeout)
+{
+    LTE_Shield_error_t flushErr = LTE_SHIELD_ERROR_SUCCESS;
+    LTE_Shield_error_t err;
 
-    responseStart = strstr(response, "+USOCR");
-    if (responseStart == NULL)
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
     {
-        free(command);
-        free(response);
-        return -1;
+        flushErr = socketFlush(socket);
+        if (flushErr != LTE_SHIELD_ERROR_SUCCESS)
+            _txBuffers[socket].length = 0; // Whatever it managed to send, the socket is going
     }
-
-    sscanf(responseStart, "+USOCR: %d", &sockId);
-
-    free(command);
-    free(response);
-
-    return sockId;
+#endif
+    err = waitForCommand(socketCloseAsync(socket, timeout));
+    return (err == LTE_SHIELD_ERROR_SUCCESS) ? flushErr : err;
 }
 
-LTE_Shield_error_t LTE_Shield::socketClose(int socket, int timeout)
+int LTE_Shield::socketCloseAsync(int socket, int timeout, LTE_Shield_command_callback_t callback)
 {
-    LTE_Shield_error_t err;
-    char *command;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_CLOSE_SOCKET) + 10);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d", LTE_SHIELD_CLOSE_SOCKET, socket);
+    LTE_Shield_command_t *cmd;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL, timeout);
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    // Don't drop buffered data without a word, it needs a socketFlush() (or socketClose()) first
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS) && (_txBuffers[socket].data != NULL) &&
+        (_txBuffers[socket].length > 0))
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+#endif
 
-    free(command);
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, timeout, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_CLOSE_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
+    {
+        _socketFlags[socket] = 0;
+        _socketUnread[socket] = 0;
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+        _txBuffers[socket].data = NULL; // Nothing left in it, see above
+#endif
+    }
 
-    return err;
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::socketConnect(int socket, const char *address,
                                              unsigned int port)
 {
+    IPAddress ip;
+    char ipString[16];
+
     LTE_Shield_error_t err;
-    char *command;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_CONNECT_SOCKET) + strlen(address) + 11);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d,\"%s\",%d", LTE_SHIELD_CONNECT_SOCKET, socket, address, port);
+    // Connect to the address resolve() found or cached, so the lookup is only counted once.
+    // If it failed the module's own lookup would fail the same way. With caching off the
+    // module gets the name, which saves a round trip.
+    if (!isIpAddress(address) && (_dnsTtl > 0))
+    {
+        err = resolve(address, &ip);
+        if (err != LTE_SHIELD_ERROR_SUCCESS)
+            return err;
+        sprintf(ipString, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+        address = ipString;
+    }
+    return waitForCommand(socketConnectAsync(socket, address, port));
+}
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL, LTE_SHIELD_IP_CONNECT_TIMEOUT);
+int LTE_Shield::socketConnectAsync(int socket, const char *address, unsigned int port,
+                                   LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+    char ipString[16];
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_IP_CONNECT_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_CONNECT_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    appendCommand(cmd, ',');
+    appendCommandQuoted(cmd, cachedAddress(address, ipString));
+    appendCommand(cmd, ',');
+    appendCommandUnsigned(cmd, port);
+
+    return submitCommand(cmd);
+}
 
-    free(command);
+LTE_Shield_error_t LTE_Shield::socketConnectStart(int socket, const char *address, unsigned int port)
+{
+    return waitForCommand(socketConnectStartAsync(socket, address, port));
+}
 
-    return err;
+int LTE_Shield::socketConnectStartAsync(int socket, const char *address, unsigned int port,
+                                        LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+    char ipString[16];
+
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+
+    // The OK comes straight back, the connection is reported by +UUSOCO
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_CONNECT_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    appendCommand(cmd, ',');
+    appendCommandQuoted(cmd, cachedAddress(address, ipString));
+    appendCommand(cmd, ',');
+    appendCommandUnsigned(cmd, port);
+    appendCommand(cmd, ",1");
+    cmd->parser = parseSocketConnectStartResponse;
+    cmd->results[0] = &_socketFlags[socket];
+    cmd->results[1] = &_socketConnectStart[socket];
+
+    return submitCommand(cmd);
 }
 
 LTE_Shield_error_t LTE_Shield::socketWrite(int socket, const char *str)
 {
-    char *command;
-    LTE_Shield_error_t err;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_WRITE_SOCKET) + 8);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d,%d", LTE_SHIELD_WRITE_SOCKET, socket, strlen(str));
+    int written = socketWrite(socket, (const uint8_t *)str, strlen(str));
 
-    err = sendCommandWithResponse(command, "@", NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    hwPrint(str);
-
-    err = waitForResponse(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_SOCKET_WRITE_TIMEOUT);
-
-    free(command);
-    return err;
+    if (written < 0)
+        return (LTE_Shield_error_t)(-written);
+    return ((size_t)written == strlen(str)) ? LTE_SHIELD_ERROR_SUCCESS : LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
 }
 
 LTE_Shield_error_t LTE_Shield::socketWrite(int socket, String str)
@@ -1272,815 +1604,3315 @@ LTE_Shield_error_t LTE_Shield::socketWrite(int socket, String str)
     return socketWrite(socket, str.c_str());
 }
 
-LTE_Shield_error_t LTE_Shield::socketRead(int socket, int length, char *readDest)
+int LTE_Shield::socketWrite(int socket, const uint8_t *data, size_t length)
 {
-    char *command;
-    char *response;
-    char *strBegin;
-    int readIndex = 0;
+    size_t chunkMax = (_dataMode == LTE_SHIELD_DATA_MODE_HEX) ? LTE_SHIELD_SOCKET_WRITE_MAX_HEX
+                                                              : LTE_SHIELD_SOCKET_WRITE_MAX;
+
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS) && (_txBuffers[socket].data != NULL))
+        return bufferSocketWrite(socket, data, length);
+#endif
+    return sendChunks(socket, NULL, 0, data, length, chunkMax);
+}
+
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+LTE_Shield_error_t LTE_Shield::setSocketWriteBuffer(int socket, uint8_t *buffer, size_t size, size_t threshold,
+                                                    unsigned long maxLatency)
+{
+    LTE_Shield_tx_buffer_t *tx;
     LTE_Shield_error_t err;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_READ_SOCKET) + 8);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d,%d", LTE_SHIELD_READ_SOCKET, socket, length);
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS) || ((buffer != NULL) && (size == 0)))
+        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
 
-    response = lte_calloc_char(length + strlen(LTE_SHIELD_READ_SOCKET) + 24);
-    if (response == NULL)
+    // Don't strand anything waiting in the old buffer
+    tx = &_txBuffers[socket];
+    err = socketFlush(socket);
+    if (err != LTE_SHIELD_ERROR_SUCCESS)
+        return err;
+
+    memset(tx, 0, sizeof(LTE_Shield_tx_buffer_t));
+    tx->data = buffer;
+    tx->size = size;
+    tx->threshold = ((threshold == 0) || (threshold > size)) ? size : threshold;
+    tx->maxLatency = maxLatency;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+LTE_Shield_error_t LTE_Shield::socketFlush(int socket)
+{
+    LTE_Shield_tx_buffer_t *tx;
+    size_t chunkMax = (_dataMode == LTE_SHIELD_DATA_MODE_HEX) ? LTE_SHIELD_SOCKET_WRITE_MAX_HEX
+                                                              : LTE_SHIELD_SOCKET_WRITE_MAX;
+    size_t length;
+    int sent = 0;
+
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+    tx = &_txBuffers[socket];
+    if ((tx->data == NULL) || (tx->length == 0))
+        return LTE_SHIELD_ERROR_SUCCESS;
+
+    _txFlushing = true;
+    collectSocketFlush(tx); // Anything poll() already sent goes first
+    length = tx->length;
+    if (length > 0)
+        sent = sendChunks(socket, NULL, 0, tx->data, length, chunkMax);
+    _txFlushing = false;
+    if (sent < 0)
     {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+        finishSocketFlush(tx, 0, true);
+        return (LTE_Shield_error_t)(-sent);
     }
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, response,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+    finishSocketFlush(tx, sent, (size_t)sent < length);
+    if (tx->length > 0)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE; // The rest is kept for the next try
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
 
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
+struct SocketWriteStats LTE_Shield::socketWriteStats(int socket)
+{
+    struct SocketWriteStats stats;
+
+    memset(&stats, 0, sizeof(stats));
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return stats;
+    stats.writes = _txBuffers[socket].writes;
+    stats.flushes = _txBuffers[socket].flushes;
+    stats.bytes = _txBuffers[socket].bytes;
+    stats.averageBatch = (stats.flushes > 0) ? stats.bytes / stats.flushes : 0;
+    return stats;
+}
+
+int LTE_Shield::bufferSocketWrite(int socket, const uint8_t *data, size_t length)
+{
+    LTE_Shield_tx_buffer_t *tx = &_txBuffers[socket];
+    size_t taken = 0;
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+
+    tx->writes++;
+    while (taken < length)
     {
-        // Find the first double-quote:
-        strBegin = strchr(response, '\"');
+        size_t room = tx->size - tx->length;
 
-        if (strBegin == NULL)
+        if (room > 0)
         {
-            free(command);
-            free(response);
-            return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
-        }
+            size_t copy = (length - taken < room) ? length - taken : room;
 
-        while ((readIndex < length) && (readIndex < strlen(strBegin)))
+            if (tx->length == 0)
+                tx->firstWrite = millis();
+            memcpy(tx->data + tx->length, data + taken, copy);
+            tx->length += copy;
+            taken += copy;
+        }
+        if (tx->length >= tx->threshold)
         {
-            readDest[readIndex] = strBegin[1 + readIndex];
-            readIndex += 1;
+            err = socketFlush(socket);
+            if ((err != LTE_SHIELD_ERROR_SUCCESS) && (tx->length == tx->size))
+                break; // No room left for the rest
         }
     }
 
-    free(command);
-    free(response);
-
-    return err;
+    if ((taken == 0) && (length > 0))
+        return -err;
+    return taken;
 }
 
-LTE_Shield_error_t LTE_Shield::socketListen(int socket, unsigned int port)
+void LTE_Shield::flushDueSocketBuffers(void)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    size_t chunkMax = (_dataMode == LTE_SHIELD_DATA_MODE_HEX) ? LTE_SHIELD_SOCKET_WRITE_MAX_HEX
+                                                              : LTE_SHIELD_SOCKET_WRITE_MAX;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_LISTEN_SOCKET) + 9);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d,%d", LTE_SHIELD_LISTEN_SOCKET, socket, port);
+    if (_txFlushing)
+        return;
+    for (int socket = 0; socket < LTE_SHIELD_NUM_SOCKETS; socket++)
+    {
+        LTE_Shield_tx_buffer_t *tx = &_txBuffers[socket];
+        LTE_Shield_command_status_t status;
+        size_t length;
+        int handle;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+        if (tx->data == NULL)
+            continue;
+        if (tx->flushLength > 0)
+        {
+            // Never wait here, a write still queued or with the modem is left for a later poll()
+            status = commandStatus(tx->flushHandle);
+            if ((status == LTE_SHIELD_COMMAND_STATUS_QUEUED) || (status == LTE_SHIELD_COMMAND_STATUS_ACTIVE))
+                continue;
+            collectSocketFlush(tx);
+        }
+        if (tx->length == 0)
+            continue;
+        if (tx->retryDelay > 0)
+        {
+            if (millis() - tx->retryStart < tx->retryDelay)
+                continue;
+        }
+        else if (millis() - tx->firstWrite < tx->maxLatency)
+        {
+            continue;
+        }
 
-    free(command);
-    return err;
+        length = (tx->length < chunkMax) ? tx->length : chunkMax;
+        tx->flushWritten = 0;
+        handle = startSocketWrite(socket, NULL, 0, tx->data, length, &tx->flushWritten, NULL);
+        if (handle < 0)
+        {
+            finishSocketFlush(tx, 0, true);
+            continue;
+        }
+        tx->flushHandle = handle;
+        tx->flushLength = length;
+    }
 }
 
-IPAddress LTE_Shield::lastRemoteIP(void)
+void LTE_Shield::collectSocketFlush(LTE_Shield_tx_buffer_t *tx)
 {
-    return _lastRemoteIP;
+    size_t length = tx->flushLength;
+
+    if (length == 0)
+        return;
+    // flushWritten is only set if the write succeeded, and stays valid if the slot was recycled
+    waitForCommand(tx->flushHandle);
+    tx->flushLength = 0;
+    finishSocketFlush(tx, tx->flushWritten, tx->flushWritten < length);
 }
 
-boolean LTE_Shield::gpsOn(void)
+void LTE_Shield::finishSocketFlush(LTE_Shield_tx_buffer_t *tx, size_t sent, boolean failed)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    boolean on = false;
-
-    command = lte_calloc_char(strlen(LTE_SHIELD_GPS_POWER) + 2);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s?", LTE_SHIELD_GPS_POWER);
-
-    response = lte_calloc_char(24);
-    if (response == NULL)
+    if (sent > 0)
     {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+        tx->flushes++;
+        tx->bytes += sent;
+        memmove(tx->data, tx->data + sent, tx->length - sent);
+        tx->length -= sent;
     }
-
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, response,
-                                  LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
+    if (!failed)
     {
-        // Example response: "+UGPS: 0" for off "+UGPS: 1,0,1" for on
-        // May be too lazy/simple, but just search for a '1'
-        if (strchr(response, '1') != NULL)
-            on = true;
+        tx->retryDelay = 0;
+        return;
     }
 
-    free(command);
-    free(response);
-
-    return on;
+    // Don't keep hammering a socket the modem isn't taking data on
+    if (tx->retryDelay == 0)
+        tx->retryDelay = LTE_SHIELD_FLUSH_BACKOFF_MIN;
+    else if (tx->retryDelay < LTE_SHIELD_FLUSH_BACKOFF_MAX / 2)
+        tx->retryDelay *= 2;
+    else
+        tx->retryDelay = LTE_SHIELD_FLUSH_BACKOFF_MAX;
+    tx->retryStart = millis();
 }
+#endif
 
-LTE_Shield_error_t LTE_Shield::gpsPower(boolean enable, gnss_system_t gnss_sys)
+int LTE_Shield::sendChunks(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length,
+                           size_t chunkMax)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    boolean gpsState;
+    int handles[LTE_SHIELD_MAX_PENDING_COMMANDS];
+    size_t chunkLength[LTE_SHIELD_MAX_PENDING_COMMANDS];
+    size_t chunkWritten[LTE_SHIELD_MAX_PENDING_COMMANDS];
+    uint8_t first = 0;
+    uint8_t inFlight = 0;
+    size_t queued = 0;
+    size_t accepted = 0;
+    boolean failed = false;
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
 
-    // Don't turn GPS on/off if it's already on/off
-    gpsState = gpsOn();
-    if ((enable && gpsState) || (!enable && !gpsState))
+    while ((queued < length) || (inFlight > 0))
     {
-        return LTE_SHIELD_ERROR_SUCCESS;
-    }
+        // Keep the queue topped up so each write goes out as soon as the last one's "OK" arrives
+        while (!failed && (queued < length) && (inFlight < LTE_SHIELD_MAX_PENDING_COMMANDS))
+        {
+            uint8_t slot = (first + inFlight) % LTE_SHIELD_MAX_PENDING_COMMANDS;
+            int handle;
+
+            chunkLength[slot] = length - queued;
+            if (chunkLength[slot] > chunkMax)
+                chunkLength[slot] = chunkMax;
+            chunkWritten[slot] = 0;
+            handle = startSocketWrite(socket, address, port, data + queued, chunkLength[slot], &chunkWritten[slot], NULL);
+            if (handle < 0)
+            {
+                if (inFlight == 0)
+                {
+                    err = (LTE_Shield_error_t)(-handle); // Not even one slot free
+                    failed = true;
+                }
+                break; // Otherwise wait for one of ours to finish
+            }
+            handles[slot] = handle;
+            queued += chunkLength[slot];
+            inFlight++;
+        }
+        if (inFlight == 0)
+            break;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_GPS_POWER) + 8);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    if (enable)
-    {
-        sprintf(command, "%s=1,0,%d", LTE_SHIELD_GPS_POWER, gnss_sys);
-    }
-    else
-    {
-        sprintf(command, "%s=0", LTE_SHIELD_GPS_POWER);
+        err = waitForCommand(handles[first]);
+        if (!failed)
+        {
+            // Only count what arrived in order, anything after a short write is suspect
+            accepted += chunkWritten[first];
+            if ((err != LTE_SHIELD_ERROR_SUCCESS) || (chunkWritten[first] < chunkLength[first]))
+                failed = true;
+        }
+        first = (first + 1) % LTE_SHIELD_MAX_PENDING_COMMANDS;
+        inFlight--;
     }
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL, 10000);
+    if ((accepted == 0) && (length > 0) && (err != LTE_SHIELD_ERROR_SUCCESS))
+        return -err;
+    return accepted;
+}
 
-    free(command);
-    return err;
+int LTE_Shield::socketWriteAsync(int socket, const char *str, LTE_Shield_command_callback_t callback)
+{
+    return socketWriteAsync(socket, (const uint8_t *)str, strlen(str), NULL, callback);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsEnableClock(boolean enable)
+int LTE_Shield::socketWriteAsync(int socket, const uint8_t *data, size_t length, size_t *written,
+                                 LTE_Shield_command_callback_t callback)
 {
-    // AT+UGZDA=<0,1>
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    return startSocketWrite(socket, NULL, 0, data, length, written, callback);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsGetClock(struct ClockData *clock)
+int LTE_Shield::socketSendTo(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length)
 {
-    // AT+UGZDA?
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    size_t written = 0;
+    LTE_Shield_error_t err;
+
+    err = waitForCommand(startSocketWrite(socket, address, port, data, length, &written, NULL));
+    if (err != LTE_SHIELD_ERROR_SUCCESS)
+        return -err;
+    return written;
 }
 
-LTE_Shield_error_t LTE_Shield::gpsEnableFix(boolean enable)
+int LTE_Shield::socketSendToAsync(int socket, const char *address, unsigned int port, const uint8_t *data,
+                                  size_t length, size_t *written, LTE_Shield_command_callback_t callback)
 {
-    // AT+UGGGA=<0,1>
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    return startSocketWrite(socket, address, port, data, length, written, callback);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsGetFix(struct PositionData *pos)
+int LTE_Shield::socketSendToBurst(int socket, const char *address, unsigned int port, const uint8_t *data,
+                                  size_t length, size_t datagramLength)
 {
-    // AT+UGGGA?
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    size_t datagramMax = (_dataMode == LTE_SHIELD_DATA_MODE_HEX) ? LTE_SHIELD_SOCKET_WRITE_MAX_HEX
+                                                                 : LTE_SHIELD_SOCKET_WRITE_MAX;
+
+    if ((datagramLength == 0) || (datagramLength > datagramMax))
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+    return sendChunks(socket, address, port, data, length, datagramLength);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsEnablePos(boolean enable)
+int LTE_Shield::startSocketWrite(int socket, const char *address, unsigned int port, const uint8_t *data,
+                                 size_t length, size_t *written, LTE_Shield_command_callback_t callback)
 {
-    // AT+UGGLL=<0,1>
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    LTE_Shield_command_t *cmd;
+    boolean hex = (_dataMode == LTE_SHIELD_DATA_MODE_HEX);
+    int handle;
+
+    if ((length == 0) || (length > (hex ? LTE_SHIELD_SOCKET_WRITE_MAX_HEX : LTE_SHIELD_SOCKET_WRITE_MAX)))
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+
+    handle = syncDataMode();
+    if (handle < 0)
+        return handle;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_SOCKET_WRITE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, (address != NULL) ? LTE_SHIELD_SEND_TO_SOCKET : LTE_SHIELD_WRITE_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    appendCommand(cmd, ',');
+    if (address != NULL)
+    {
+        // e.g. AT+USOST=0,"192.168.0.1",16666,5
+        appendCommandQuoted(cmd, address);
+        appendCommand(cmd, ',');
+        appendCommandUnsigned(cmd, port);
+        appendCommand(cmd, ',');
+    }
+    appendCommandUnsigned(cmd, length);
+
+    if (hex)
+    {
+        // Data is encoded straight from the caller's buffer onto the command line,
+        // e.g. AT+USOWR=0,2,"4869"
+        appendCommand(cmd, ",\"");
+        cmd->payloadTerminator = '\"';
+        cmd->hex = true;
+    }
+    else
+    {
+        // Data is sent after the '@' prompt, byte for byte
+        cmd->prompt = "@";
+    }
+    cmd->payload = (const char *)data;
+    cmd->payloadLength = length;
+    if (written != NULL)
+    {
+        cmd->parser = parseSocketWriteResponse;
+        cmd->results[0] = written;
+    }
+
+    return submitCommand(cmd);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsGetPos(struct PositionData *pos)
+LTE_Shield_error_t LTE_Shield::socketRead(int socket, int length, char *readDest, int *readLength)
 {
-    // AT+UGGLL?
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    return waitForCommand(startSocketRead(socket, length, readDest, readLength));
 }
 
-LTE_Shield_error_t LTE_Shield::gpsEnableSat(boolean enable)
+int LTE_Shield::socketReadAsync(int socket, int length, char *readDest,
+                                LTE_Shield_command_callback_t callback)
 {
-    // AT+UGGSV=<0,1>
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    return startSocketRead(socket, length, readDest, NULL, callback);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsGetSat(uint8_t *sats)
+int LTE_Shield::startSocketRead(int socket, int length, char *readDest, int *readLength,
+                                LTE_Shield_command_callback_t callback)
 {
-    // AT+UGGSV?
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    LTE_Shield_command_t *cmd;
+    int handle;
+
+    if (length < 0)
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+
+    handle = syncDataMode();
+    if (handle < 0)
+        return handle;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_READ_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    appendCommand(cmd, ',');
+    appendCommandInt(cmd, length);
+
+    // Data is copied (or in hex mode decoded) into readDest as it arrives, only the header is captured
+    cmd->dataDest = readDest;
+    cmd->dataSize = length;
+    cmd->hex = (_dataMode == LTE_SHIELD_DATA_MODE_HEX);
+    cmd->results[0] = readLength;
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
+    {
+        // Count what we take off the modem against what +UUSORD announced
+        cmd->parser = parseSocketReadResponse;
+        cmd->results[1] = &_socketUnread[socket];
+    }
+
+    return submitCommand(cmd);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsEnableRmc(boolean enable)
+LTE_Shield_error_t LTE_Shield::socketRecvFrom(int socket, int length, char *readDest, int *readLength,
+                                              IPAddress *remoteIP, unsigned int *remotePort)
 {
-    // AT+UGRMC=<0,1>
-    LTE_Shield_error_t err;
-    char *command;
+    return waitForCommand(socketRecvFromAsync(socket, length, readDest, readLength, remoteIP, remotePort));
+}
 
-    if (!gpsOn())
-    {
-        err = gpsPower(true);
-        if (err != LTE_SHIELD_ERROR_SUCCESS)
-        {
-            return err;
-        }
+int LTE_Shield::socketRecvFromAsync(int socket, int length, char *readDest, int *readLength,
+                                    IPAddress *remoteIP, unsigned int *remotePort,
+                                    LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+    int handle;
+
+    if (length < 0)
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+
+    handle = syncDataMode();
+    if (handle < 0)
+        return handle;
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_RECV_FROM);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    appendCommand(cmd, ',');
+    appendCommandInt(cmd, length);
+
+    // e.g. +USORF: 0,"192.168.0.1",16666,5,"hello" -- the address is captured, the data isn't
+    cmd->dataDest = readDest;
+    cmd->dataSize = length;
+    cmd->dataSkipQuotes = 2;
+    cmd->hex = (_dataMode == LTE_SHIELD_DATA_MODE_HEX);
+    cmd->parser = parseSocketRecvFromResponse;
+    cmd->results[0] = readLength;
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
+    {
+        cmd->results[1] = &_socketUnread[socket];
     }
+    cmd->results[2] = remoteIP;
+    cmd->results[3] = remotePort;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_GPS_GPRMC) + 3);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d", LTE_SHIELD_GPS_GPRMC, enable ? 1 : 0);
+    return submitCommand(cmd);
+}
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL, 10000);
+int LTE_Shield::socketReadAll(int socket, char *buffer, size_t chunkSize,
+                              void (*consumer)(int socket, const uint8_t *data, size_t length))
+{
+    int length = -1;
 
-    free(command);
-    return err;
+    if ((buffer == NULL) || (chunkSize == 0) || (consumer == NULL))
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
+
+    // Data announced but not yet read says how much is waiting, which saves the read that comes back empty
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS) && (_socketUnread[socket] > 0))
+    {
+        length = _socketUnread[socket];
+    }
+    return drainSocket(socket, length, buffer, chunkSize, consumer);
 }
 
-LTE_Shield_error_t LTE_Shield::gpsGetRmc(struct PositionData *pos, struct SpeedData *spd,
-                                         struct ClockData *clk, boolean *valid)
+int LTE_Shield::drainSocket(int socket, int length, char *buffer, size_t chunkSize,
+                            void (*consumer)(int, const uint8_t *, size_t))
 {
+    size_t readMax = (_dataMode == LTE_SHIELD_DATA_MODE_HEX) ? LTE_SHIELD_SOCKET_READ_MAX_HEX
+                                                             : LTE_SHIELD_SOCKET_READ_MAX;
+    int readTotal = 0;
     LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    char *rmcBegin;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_GPS_GPRMC) + 2);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s?", LTE_SHIELD_GPS_GPRMC);
+    if (chunkSize > readMax)
+        chunkSize = readMax;
 
-    response = lte_calloc_char(96);
-    if (response == NULL)
+    // Successive +USORDs into the same buffer until length is read. Without a length,
+    // until a short read says the module has nothing more.
+    while (length != 0)
     {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    }
+        int request = ((length > 0) && ((size_t)length < chunkSize)) ? length : chunkSize;
+        int readLength = 0;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, response, 10000);
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
-    {
-        // Fast-forward response string to $GPRMC starter
-        rmcBegin = strstr(response, "$GPRMC");
-        if (rmcBegin == NULL)
+        err = waitForCommand(startSocketRead(socket, request, buffer, &readLength));
+        if (err != LTE_SHIELD_ERROR_SUCCESS)
+            return (readTotal > 0) ? readTotal : -err;
+        if (readLength <= 0)
         {
-            err = LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+            if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
+                _socketUnread[socket] = 0; // Whatever was announced, the module has nothing
+            break;
+        }
+
+        readTotal += readLength;
+        if (consumer != NULL)
+        {
+            consumer(socket, (const uint8_t *)buffer, readLength);
+        }
+        else
+        {
+            // The read callbacks, buffer has room for a terminator
+            if (_socketDataCallback != NULL)
+            {
+                _socketDataCallback(socket, (const uint8_t *)buffer, readLength);
+            }
+            if (_socketReadCallback != NULL)
+            {
+                buffer[readLength] = '\0';
+                _socketReadCallback(socket, String(buffer));
+            }
+        }
+
+        if (length < 0)
+        {
+            if (readLength < request)
+                break;
         }
         else
         {
-            *valid = parseGPRMCString(rmcBegin, pos, clk, spd);
+            length = (readLength < length) ? length - readLength : 0;
         }
     }
-
-    free(command);
-    free(response);
-    return err;
+    return readTotal;
 }
 
-LTE_Shield_error_t LTE_Shield::gpsEnableSpeed(boolean enable)
+int LTE_Shield::syncDataMode(void)
 {
-    // AT+UGVTG=<0,1>
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    LTE_Shield_command_t *cmd;
+    int handle;
+
+    if (_modemDataMode == _dataMode)
+        return 0;
+
+    // Queued ahead of the transfer that needs it, so the two go out back to back
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_DATA_CONFIG);
+    appendCommand(cmd, "=1,");
+    appendCommandInt(cmd, _dataMode);
+
+    handle = submitCommand(cmd);
+    if (handle >= 0)
+    {
+        _modemDataMode = _dataMode;
+    }
+    return handle;
 }
 
-LTE_Shield_error_t LTE_Shield::gpsGetSpeed(struct SpeedData *speed)
+LTE_Shield_error_t LTE_Shield::socketListen(int socket, unsigned int port)
 {
-    // AT+UGVTG?
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
-    return err;
+    return waitForCommand(socketListenAsync(socket, port));
 }
 
-LTE_Shield_error_t LTE_Shield::gpsRequest(unsigned int timeout, uint32_t accuracy,
-                                          boolean detailed)
+int LTE_Shield::socketListenAsync(int socket, unsigned int port, LTE_Shield_command_callback_t callback)
 {
-    // AT+ULOC=2,<useCellLocate>,<detailed>,<timeout>,<accuracy>
-    LTE_Shield_error_t err;
-    char *command;
-
-    // This function will only work if the GPS module is initially turned off.
-    if (gpsOn())
-    {
-        gpsPower(false);
-    }
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_LISTEN_SOCKET);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
+    appendCommand(cmd, ',');
+    appendCommandUnsigned(cmd, port);
+
+    return submitCommand(cmd);
+}
 
-    if (timeout > 999)
-        timeout = 999;
-    if (accuracy > 999999)
-        accuracy = 999999;
+IPAddress LTE_Shield::lastRemoteIP(void)
+{
+    return _lastRemoteIP;
+}
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_GPS_REQUEST_LOCATION) + 24);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=2,3,%d,%d,%d", LTE_SHIELD_GPS_REQUEST_LOCATION,
-            detailed ? 1 : 0, timeout, accuracy);
+void LTE_Shield::deferSocketRead(int socket, boolean defer)
+{
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return;
+    if (defer)
+        _socketFlags[socket] |= LTE_SHIELD_SOCKET_DEFERRED;
+    else
+        _socketFlags[socket] &= ~LTE_SHIELD_SOCKET_DEFERRED;
+}
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK, NULL, 10000);
+int LTE_Shield::socketAvailable(int socket)
+{
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return 0;
+    return _socketUnread[socket];
+}
 
-    free(command);
-    return err;
+boolean LTE_Shield::socketClosed(int socket)
+{
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return true;
+    return (_socketFlags[socket] & LTE_SHIELD_SOCKET_CLOSED) != 0;
 }
 
-/////////////
-// Private //
-/////////////
+boolean LTE_Shield::socketConnecting(int socket)
+{
+    if ((socket < 0) || (socket >= LTE_SHIELD_NUM_SOCKETS))
+        return false;
+    return (_socketFlags[socket] & LTE_SHIELD_SOCKET_CONNECTING) != 0;
+}
 
-LTE_Shield_error_t LTE_Shield::init(unsigned long baud,
-                                    LTE_Shield::LTE_Shield_init_type_t initType)
+LTE_Shield_error_t LTE_Shield::resolve(const char *host, IPAddress *ip)
 {
+    LTE_Shield_command_t *cmd;
+    uint8_t address[4];
     LTE_Shield_error_t err;
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    LTE_Shield_dns_entry_t *entry;
+#endif
 
-    beginSerial(baud); // Begin serial
+    if ((host == NULL) || (ip == NULL))
+        return LTE_SHIELD_ERROR_UNEXPECTED_PARAM;
 
-    if (initType == LTE_SHIELD_INIT_AUTOBAUD)
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    entry = findDnsEntry(host);
+    if (entry != NULL)
     {
-        if (autobaud(baud) != LTE_SHIELD_ERROR_SUCCESS)
+        _dnsHits++;
+        for (int octet = 0; octet < 4; octet++)
         {
-            return init(baud, LTE_SHIELD_INIT_RESET);
+            (*ip)[octet] = entry->ip[octet];
         }
+        return LTE_SHIELD_ERROR_SUCCESS;
     }
-    else if (initType == LTE_SHIELD_INIT_RESET)
+#endif
+    _dnsMisses++;
+
+    // e.g. AT+UDNSRN=0,"example.com" answers +UDNSRN: "93.184.216.34"
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_DNS_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_RESOLVE_NAME);
+    appendCommand(cmd, "=0,");
+    appendCommandQuoted(cmd, host);
+    cmd->parser = parseResolveResponse;
+    cmd->results[0] = address;
+    err = waitForCommand(submitCommand(cmd));
+    if (err != LTE_SHIELD_ERROR_SUCCESS)
     {
-        powerOn();
-        if (at() != LTE_SHIELD_ERROR_SUCCESS)
+        _dnsFailures++;
+        return err;
+    }
+    for (int octet = 0; octet < 4; octet++)
+    {
+        (*ip)[octet] = address[octet];
+    }
+
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    // Names too long for the cache are still resolved, just not kept
+    if ((_dnsTtl == 0) || (strlen(host) >= LTE_SHIELD_DNS_HOST_SIZE))
+        return LTE_SHIELD_ERROR_SUCCESS;
+
+    // Replace an unused or expired entry if there is one, otherwise the oldest
+    entry = &_dnsCache[0];
+    for (int i = 0; i < LTE_SHIELD_DNS_CACHE_SIZE; i++)
+    {
+        if ((_dnsCache[i].host[0] == '\0') || (millis() - _dnsCache[i].resolved >= _dnsTtl))
         {
-            return init(baud, LTE_SHIELD_INIT_AUTOBAUD);
+            entry = &_dnsCache[i];
+            break;
         }
+        if (millis() - _dnsCache[i].resolved > millis() - entry->resolved)
+            entry = &_dnsCache[i];
     }
+    strcpy(entry->host, host);
+    memcpy(entry->ip, address, sizeof(entry->ip));
+    entry->resolved = millis();
+#endif
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
 
-    // Use disable echo to test response
-    err = enableEcho(false);
+void LTE_Shield::setDnsCacheTtl(unsigned long ttl)
+{
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    _dnsTtl = ttl;
+#endif
+}
 
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
-        return init(baud, LTE_SHIELD_INIT_AUTOBAUD);
+void LTE_Shield::clearDnsCache(void)
+{
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    memset(_dnsCache, 0, sizeof(_dnsCache));
+#endif
+}
 
-    _baud = baud;
-    setGpioMode(GPIO1, NETWORK_STATUS);
-    setGpioMode(GPIO2, GNSS_SUPPLY_ENABLE);
-    setSMSMessageFormat(LTE_SHIELD_MESSAGE_FORMAT_TEXT);
-    autoTimeZone(true);
-    for (int i = 0; i < LTE_SHIELD_NUM_SOCKETS; i++)
+struct DnsCacheStats LTE_Shield::dnsCacheStats(void)
+{
+    struct DnsCacheStats stats;
+
+    stats.hits = _dnsHits;
+    stats.misses = _dnsMisses;
+    stats.failures = _dnsFailures;
+    stats.entries = 0;
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    for (int i = 0; i < LTE_SHIELD_DNS_CACHE_SIZE; i++)
     {
-        socketClose(i, 100);
+        if ((_dnsCache[i].host[0] != '\0') && (millis() - _dnsCache[i].resolved < _dnsTtl))
+            stats.entries++;
     }
+#endif
+    return stats;
+}
 
-    return LTE_SHIELD_ERROR_SUCCESS;
+int LTE_Shield::prewarmDnsCache(const char *const *hosts, uint8_t count)
+{
+    IPAddress ip;
+    int resolved = 0;
+
+    if ((hosts == NULL) || (_dnsTtl == 0))
+        return 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (resolve(hosts[i], &ip) == LTE_SHIELD_ERROR_SUCCESS)
+            resolved++;
+    }
+    return resolved;
 }
 
-void LTE_Shield::powerOn(void)
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+LTE_Shield::LTE_Shield_dns_entry_t *LTE_Shield::findDnsEntry(const char *host)
 {
-    pinMode(_powerPin, OUTPUT);
-    digitalWrite(_powerPin, LOW);
-    delay(LTE_SHIELD_POWER_PULSE_PERIOD);
-    pinMode(_powerPin, INPUT); // Return to high-impedance, rely on SARA module internal pull-up
+    for (int i = 0; i < LTE_SHIELD_DNS_CACHE_SIZE; i++)
+    {
+        if ((_dnsCache[i].host[0] != '\0') && (millis() - _dnsCache[i].resolved < _dnsTtl) &&
+            (strcmp(_dnsCache[i].host, host) == 0))
+            return &_dnsCache[i];
+    }
+    return NULL;
 }
 
-void LTE_Shield::hwReset(void)
+#endif
+
+const char *LTE_Shield::cachedAddress(const char *address, char *ipString)
 {
-    pinMode(_resetPin, OUTPUT);
-    digitalWrite(_resetPin, LOW);
-    delay(LTE_RESET_PULSE_PERIOD);
-    pinMode(_resetPin, INPUT); // Return to high-impedance, rely on SARA module internal pull-up
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    LTE_Shield_dns_entry_t *entry;
+#endif
+
+    if (isIpAddress(address) || (_dnsTtl == 0))
+        return address;
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    entry = findDnsEntry(address);
+    if (entry == NULL)
+    {
+        _dnsMisses++; // The module will look it up
+        return address;
+    }
+    _dnsHits++;
+    sprintf(ipString, "%d.%d.%d.%d", entry->ip[0], entry->ip[1], entry->ip[2], entry->ip[3]);
+    return ipString;
+#else
+    return address;
+#endif
 }
 
-LTE_Shield_error_t LTE_Shield::functionality(LTE_Shield_functionality_t function)
+LTE_Shield_error_t LTE_Shield::directLinkBegin(int socket)
 {
+    LTE_Shield_command_t *cmd;
     LTE_Shield_error_t err;
-    char *command;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_FUNC) + 4);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d", LTE_SHIELD_COMMAND_FUNC, function);
+    // Anything queued behind +USODL would be sent down the socket as data
+    if (_directLink || (pendingCommands() > 0))
+        return LTE_SHIELD_ERROR_INVALID;
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  NULL, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_CONNECT, LTE_SHIELD_DIRECT_LINK_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_DIRECT_LINK);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, socket);
 
-    free(command);
+    err = waitForCommand(submitCommand(cmd));
+    if (err != LTE_SHIELD_ERROR_SUCCESS)
+        return err;
 
-    return err;
+    // Bytes that followed CONNECT are already in _rxBuffer, directLinkRead() starts with them
+    _directLink = true;
+    _directLinkStart = millis();
+    _directLinkLastTx = _directLinkStart;
+    _directLinkSent = 0;
+    _directLinkReceived = 0;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-LTE_Shield_error_t LTE_Shield::setMno(mobile_network_operator_t mno)
+size_t LTE_Shield::directLinkWrite(const uint8_t *data, size_t length)
 {
-    LTE_Shield_error_t err;
-    char *command;
+    size_t written = 0;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_MNO) + 3);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s=%d", LTE_SHIELD_COMMAND_MNO, (uint8_t)mno);
-
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  NULL, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
+    if (!_directLink)
+        return 0;
 
-    free(command);
+    while ((written < length) && (hwWrite(data[written]) == 1))
+        written++;
+    if (written > 0)
+        _directLinkLastTx = millis();
+    _directLinkSent += written;
+    return written;
+}
 
-    return err;
+int LTE_Shield::directLinkAvailable(void)
+{
+    if (!_directLink)
+        return 0;
+    return ((_rxHead + LTE_SHIELD_RX_BUFFER_SIZE - _rxTail) % LTE_SHIELD_RX_BUFFER_SIZE) + hwAvailable();
 }
 
-LTE_Shield_error_t LTE_Shield::getMno(mobile_network_operator_t *mno)
+int LTE_Shield::directLinkRead(uint8_t *buf, size_t length)
 {
-    LTE_Shield_error_t err;
-    char *command;
-    char *response;
-    const char *mno_keys = "0123456"; // Valid MNO responses
-    int i;
+    size_t got = 0;
 
-    command = lte_calloc_char(strlen(LTE_SHIELD_COMMAND_MNO) + 2);
-    if (command == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
-    sprintf(command, "%s?", LTE_SHIELD_COMMAND_MNO);
+    if (!_directLink)
+        return 0;
 
-    response = lte_calloc_char(24);
-    if (response == NULL)
+    while (got < length)
     {
-        free(command);
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+        if (_rxHead != _rxTail)
+            buf[got++] = rxRead();
+        else if (hwAvailable() > 0)
+            buf[got++] = readChar();
+        else
+            break;
     }
+    _directLinkReceived += got;
+    return got;
+}
 
-    err = sendCommandWithResponse(command, LTE_SHIELD_RESPONSE_OK,
-                                  response, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT);
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
-    {
-        free(command);
-        free(response);
-        return err;
+LTE_Shield_error_t LTE_Shield::directLinkEnd(void)
+{
+    unsigned long quiet;
+    unsigned long start;
+    int c;
+
+    if (!_directLink)
+        return LTE_SHIELD_ERROR_INVALID;
+
+    // The module only takes "+++" as an escape with silence before and after it
+    _directLinkEnd = millis();
+    quiet = millis() - _directLinkLastTx;
+    if (quiet < LTE_SHIELD_DIRECT_LINK_GUARD)
+        delay(LTE_SHIELD_DIRECT_LINK_GUARD - quiet);
+    hwPrint(LTE_SHIELD_DIRECT_LINK_ESCAPE);
+    _directLinkLastTx = millis();
+
+    // Skip whatever the socket still sends until the module says it's back in command mode
+    _rxLineLength = 0;
+    _rxLineOverflow = false;
+    start = millis();
+    while (millis() - start < LTE_SHIELD_DIRECT_LINK_GUARD + LTE_SHIELD_DIRECT_LINK_TIMEOUT)
+    {
+        if (_rxHead != _rxTail)
+            c = rxRead();
+        else if (hwAvailable() > 0)
+            c = readChar();
+        else
+        {
+            delay(LTE_SHIELD_POLL_DELAY);
+            continue;
+        }
+        if (assembleLine(c) && ((strcmp(_rxLine, "DISCONNECT") == 0) || (strcmp(_rxLine, "OK") == 0)))
+        {
+            _directLink = false;
+            return LTE_SHIELD_ERROR_SUCCESS;
+        }
     }
+    // Still in direct link, the escape can be tried again
+    return LTE_SHIELD_ERROR_TIMEOUT;
+}
 
-    i = strcspn(response, mno_keys); // Find first occurence of MNO key
-    if (i == strlen(response))
+boolean LTE_Shield::directLinkActive(void)
+{
+    return _directLink;
+}
+
+struct DirectLinkStats LTE_Shield::directLinkStats(void)
+{
+    struct DirectLinkStats stats;
+
+    stats.bytesSent = _directLinkSent;
+    stats.bytesReceived = _directLinkReceived;
+    if (_directLink)
+        stats.duration = millis() - _directLinkStart;
+    else
+        stats.duration = _directLinkEnd - _directLinkStart;
+    stats.rate = 0;
+    if (stats.duration > 0)
+        stats.rate = ((stats.bytesSent + stats.bytesReceived) * 1000.0) / stats.duration;
+    return stats;
+}
+
+void LTE_Shield::setSocketDataMode(lte_shield_data_mode_t mode)
+{
+    _dataMode = mode;
+}
+
+lte_shield_data_mode_t LTE_Shield::socketDataMode(void)
+{
+    return _dataMode;
+}
+
+LTE_Shield_error_t LTE_Shield::setPsm(boolean enable, unsigned long periodicTau, unsigned long activeTime)
+{
+    return waitForCommand(setPsmAsync(enable, periodicTau, activeTime));
+}
+
+int LTE_Shield::setPsmAsync(boolean enable, unsigned long periodicTau, unsigned long activeTime,
+                            LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+    char timer[9];
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    // e.g. AT+CPSMS=1,,,"00100001","00000101";+UPSMR=1 -- the GPRS timers don't apply to LTE
+    appendCommand(cmd, LTE_SHIELD_PSM);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, enable ? 1 : 0);
+    if (enable)
     {
-        *mno = MNO_INVALID;
-        free(command);
-        free(response);
-        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+        appendCommand(cmd, ",,,");
+        encodePsmTimer(periodicTau, LTE_SHIELD_PSM_TAU_UNITS, NUM_PSM_TAU_UNITS, timer);
+        appendCommandQuoted(cmd, timer);
+        appendCommand(cmd, ',');
+        encodePsmTimer(activeTime, LTE_SHIELD_PSM_ACTIVE_UNITS, NUM_PSM_ACTIVE_UNITS, timer);
+        appendCommandQuoted(cmd, timer);
     }
-    *mno = (mobile_network_operator_t)(response[i] - 0x30); // Convert to integer
+    appendCommand(cmd, ';');
+    appendCommand(cmd, LTE_SHIELD_PSM_URC);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, enable ? 1 : 0);
 
-    free(command);
-    free(response);
+    return submitCommand(cmd);
+}
 
-    return err;
+LTE_Shield_error_t LTE_Shield::psm(struct PsmSettings *granted)
+{
+    return waitForCommand(psmAsync(granted));
 }
 
-/*LTE_Shield_error_t LTE_Shield::sendCommandWithResponseAndTimeout(const char * command,
-    char * expectedResponse, uint16_t commandTimeout, boolean at)
+int LTE_Shield::psmAsync(struct PsmSettings *granted, LTE_Shield_command_callback_t callback)
 {
-    unsigned long timeIn = millis();
-    char * response;
+    LTE_Shield_command_t *cmd;
 
-    sendCommand(command, at);
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_PSM_GRANTED);
+    appendCommand(cmd, '?');
+    cmd->parser = parsePsmResponse;
+    cmd->results[0] = granted;
 
-    // Wait until we've receved the requested number of characters
-    while (hwAvailable() < strlen(expectedResponse))
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::setEdrx(boolean enable, unsigned long cycle)
+{
+    return waitForCommand(setEdrxAsync(enable, cycle));
+}
+
+int LTE_Shield::setEdrxAsync(boolean enable, unsigned long cycle, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+    char value[5];
+    int code = 0;
+
+    // Shortest cycle at least as long as the one asked for
+    while ((code < NUM_EDRX_CYCLES - 1) && (LTE_SHIELD_EDRX_CYCLES[code] < cycle))
+        code++;
+    for (int bit = 0; bit < 4; bit++)
+        value[bit] = (code & (0x08 >> bit)) ? '1' : '0';
+    value[4] = '\0';
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    // e.g. AT+CEDRXS=1,4,"0010"
+    appendCommand(cmd, LTE_SHIELD_EDRX);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, enable ? 1 : 0);
+    appendCommand(cmd, ',');
+    appendCommandInt(cmd, LTE_SHIELD_EDRX_ACT_CAT_M1);
+    if (enable)
     {
-        if (millis() > timeIn + commandTimeout)
-        {
-            return LTE_SHIELD_ERROR_TIMEOUT;
-        }
+        appendCommand(cmd, ',');
+        appendCommandQuoted(cmd, value);
     }
-    response = lte_calloc_char(hwAvailable() + 1);
-    if (response == NULL)
-    {
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::edrx(struct EdrxSettings *granted)
+{
+    return waitForCommand(edrxAsync(granted));
+}
+
+int LTE_Shield::edrxAsync(struct EdrxSettings *granted, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_EDRX_GRANTED);
+    cmd->parser = parseEdrxResponse;
+    cmd->results[0] = granted;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::setUartPowerSaving(lte_shield_uart_power_saving_t mode)
+{
+    return waitForCommand(setUartPowerSavingAsync(mode));
+}
+
+int LTE_Shield::setUartPowerSavingAsync(lte_shield_uart_power_saving_t mode,
+                                        LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_UART_POWER_SAVING);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, mode);
+
+    return submitCommand(cmd);
+}
+
+boolean LTE_Shield::asleep(void)
+{
+    return _asleep;
+}
+
+void LTE_Shield::wake(void)
+{
+    if (!_asleep || _wakeRequested)
+        return;
+
+    pinMode(_powerPin, OUTPUT);
+    digitalWrite(_powerPin, LOW);
+    delay(LTE_SHIELD_WAKE_PULSE_PERIOD);
+    pinMode(_powerPin, INPUT);
+    _wakeRequested = true;
+    _wakeTime = millis();
+}
+
+boolean LTE_Shield::gpsOn(void)
+{
+    boolean on = false;
+
+    waitForCommand(gpsOnAsync(&on));
+    return on;
+}
+
+int LTE_Shield::gpsOnAsync(boolean *on, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_GPS_POWER);
+    appendCommand(cmd, '?');
+    cmd->parser = parseGpsOnResponse;
+    cmd->results[0] = on;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::gpsPower(boolean enable, gnss_system_t gnss_sys)
+{
+    boolean gpsState;
+
+    // Don't turn GPS on/off if it's already on/off
+    gpsState = gpsOn();
+    if ((enable && gpsState) || (!enable && !gpsState))
+    {
+        return LTE_SHIELD_ERROR_SUCCESS;
+    }
+
+    return waitForCommand(gpsPowerAsync(enable, gnss_sys));
+}
+
+int LTE_Shield::gpsPowerAsync(boolean enable, gnss_system_t gnss_sys,
+                              LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 10000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    if (enable)
+    {
+        appendCommand(cmd, LTE_SHIELD_GPS_POWER);
+        appendCommand(cmd, "=1,0,");
+        appendCommandInt(cmd, gnss_sys);
+    }
+    else
+    {
+        appendCommand(cmd, LTE_SHIELD_GPS_POWER);
+        appendCommand(cmd, "=0");
+    }
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::gpsEnableClock(boolean enable)
+{
+    // AT+UGZDA=<0,1>
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsGetClock(struct ClockData *clock)
+{
+    // AT+UGZDA?
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsEnableFix(boolean enable)
+{
+    // AT+UGGGA=<0,1>
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsGetFix(struct PositionData *pos)
+{
+    // AT+UGGGA?
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsEnablePos(boolean enable)
+{
+    // AT+UGGLL=<0,1>
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsGetPos(struct PositionData *pos)
+{
+    // AT+UGGLL?
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsEnableSat(boolean enable)
+{
+    // AT+UGGSV=<0,1>
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsGetSat(uint8_t *sats)
+{
+    // AT+UGGSV?
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsEnableRmc(boolean enable)
+{
+    // AT+UGRMC=<0,1>
+    LTE_Shield_error_t err;
+
+    if (!gpsOn())
+    {
+        err = gpsPower(true);
+        if (err != LTE_SHIELD_ERROR_SUCCESS)
+        {
+            return err;
+        }
+    }
+
+    return waitForCommand(gpsEnableRmcAsync(enable));
+}
+
+int LTE_Shield::gpsEnableRmcAsync(boolean enable, LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 10000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_GPS_GPRMC);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, enable ? 1 : 0);
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::gpsGetRmc(struct PositionData *pos, struct SpeedData *spd,
+                                         struct ClockData *clk, boolean *valid)
+{
+    return waitForCommand(gpsGetRmcAsync(pos, spd, clk, valid));
+}
+
+int LTE_Shield::gpsGetRmcAsync(struct PositionData *pos, struct SpeedData *spd,
+                               struct ClockData *clk, boolean *valid,
+                               LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 10000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_GPS_GPRMC);
+    appendCommand(cmd, '?');
+    cmd->parser = parseRmcResponse;
+    cmd->results[0] = pos;
+    cmd->results[1] = spd;
+    cmd->results[2] = clk;
+    cmd->results[3] = valid;
+
+    return submitCommand(cmd);
+}
+
+LTE_Shield_error_t LTE_Shield::gpsEnableSpeed(boolean enable)
+{
+    // AT+UGVTG=<0,1>
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsGetSpeed(struct SpeedData *speed)
+{
+    // AT+UGVTG?
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_SUCCESS;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::gpsRequest(unsigned int timeout, uint32_t accuracy,
+                                          boolean detailed)
+{
+    // This function will only work if the GPS module is initially turned off.
+    if (gpsOn())
+    {
+        gpsPower(false);
+    }
+
+    return waitForCommand(gpsRequestAsync(timeout, accuracy, detailed));
+}
+
+int LTE_Shield::gpsRequestAsync(unsigned int timeout, uint32_t accuracy, boolean detailed,
+                                LTE_Shield_command_callback_t callback)
+{
+    // AT+ULOC=2,<useCellLocate>,<detailed>,<timeout>,<accuracy>
+    LTE_Shield_command_t *cmd;
+
+    if (timeout > 999)
+        timeout = 999;
+    if (accuracy > 999999)
+        accuracy = 999999;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, 10000, callback);
+    if (cmd == NULL)
+        return -LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_GPS_REQUEST_LOCATION);
+    appendCommand(cmd, "=2,3,");
+    appendCommandInt(cmd, detailed ? 1 : 0);
+    appendCommand(cmd, ',');
+    appendCommandUnsigned(cmd, timeout);
+    appendCommand(cmd, ',');
+    appendCommandUnsigned(cmd, accuracy);
+
+    return submitCommand(cmd);
+}
+
+
+/////////////
+// Private //
+/////////////
+
+LTE_Shield_error_t LTE_Shield::init(unsigned long baud,
+                                    LTE_Shield::LTE_Shield_init_type_t initType)
+{
+    LTE_Shield_error_t err;
+
+    if (initType == LTE_SHIELD_INIT_STANDARD)
+    {
+        // Autobaud/reset retries recurse back in here, only time from the top
+        _initStats.duration = millis();
+        _initStats.roundTrips = _commandsSent;
+        _initStats.autobaudProbes = 0;
+        _initStats.autobaudDuration = 0;
+        _storedBaud = (_baudLoad != NULL) ? _baudLoad() : 0;
+    }
+
+    beginSerial(baud); // Begin serial
+
+    // Each failure escalates STANDARD -> AUTOBAUD -> RESET, a failed RESET gives up
+    if (initType == LTE_SHIELD_INIT_AUTOBAUD)
+    {
+        if (autobaud(baud) != LTE_SHIELD_ERROR_SUCCESS)
+        {
+            return init(baud, LTE_SHIELD_INIT_RESET);
+        }
+    }
+    else if (initType == LTE_SHIELD_INIT_RESET)
+    {
+        powerOn();
+        _freshBoot = true;
+        if ((at() != LTE_SHIELD_ERROR_SUCCESS) && (autobaud(baud) != LTE_SHIELD_ERROR_SUCCESS))
+        {
+            return LTE_SHIELD_ERROR_NO_RESPONSE;
+        }
+    }
+
+    // Use disable echo to test response
+    err = enableEcho(false);
+
+    if (err != LTE_SHIELD_ERROR_SUCCESS)
+    {
+        if (initType == LTE_SHIELD_INIT_STANDARD)
+            return init(baud, LTE_SHIELD_INIT_AUTOBAUD);
+        if (initType == LTE_SHIELD_INIT_AUTOBAUD)
+            return init(baud, LTE_SHIELD_INIT_RESET);
+        return err;
+    }
+
+    _baud = baud;
+    if ((_baudSave != NULL) && (baud != _storedBaud))
+    {
+        _baudSave(baud);
+        _storedBaud = baud;
+    }
+    configure();
+    if (!_freshBoot)
+    {
+        closeAllSockets();
+    }
+    _freshBoot = false;
+
+    _initStats.duration = millis() - _initStats.duration;
+    _initStats.roundTrips = _commandsSent - _initStats.roundTrips;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+void LTE_Shield::configure(void)
+{
+    LTE_Shield_command_t *cmd;
+    uint8_t current = 0;
+
+    // Read back every setting in one go, then write only the ones that differ.
+    // The module accepts several extended commands on one line, separated by ';'.
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_CMEE);
+    appendCommand(cmd, "?;");
+    appendCommand(cmd, LTE_SHIELD_COMMAND_GPIO);
+    appendCommand(cmd, "?;");
+    appendCommand(cmd, LTE_SHIELD_MESSAGE_FORMAT);
+    appendCommand(cmd, "?;");
+    appendCommand(cmd, LTE_SHIELD_COMMAND_AUTO_TZ);
+    appendCommand(cmd, "?;");
+    appendCommand(cmd, LTE_SHIELD_DATA_CONFIG);
+    appendCommand(cmd, "=1");
+    cmd->recordParser = parseConfigRecord;
+    cmd->recordDelimiter = '\n';
+    cmd->results[0] = &current;
+    if (waitForCommand(submitCommand(cmd)) != LTE_SHIELD_ERROR_SUCCESS)
+    {
+        current = 0; // Don't trust a partial read, set everything
+        _modemDataMode = -1;
+    }
+    else
+    {
+        // A restarted sketch may find the module still in hex mode
+        _modemDataMode = (current & LTE_SHIELD_CONFIG_HEX) ? LTE_SHIELD_DATA_MODE_HEX : LTE_SHIELD_DATA_MODE_TEXT;
+    }
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return;
+    if (!(current & LTE_SHIELD_CONFIG_CMEE))
+    {
+        appendCommand(cmd, LTE_SHIELD_COMMAND_CMEE);
+        appendCommand(cmd, "=1;");
+    }
+    if (!(current & LTE_SHIELD_CONFIG_GPIO1))
+    {
+        appendCommand(cmd, LTE_SHIELD_COMMAND_GPIO);
+        appendCommand(cmd, '=');
+        appendCommandInt(cmd, GPIO1);
+        appendCommand(cmd, ',');
+        appendCommandInt(cmd, NETWORK_STATUS);
+        appendCommand(cmd, ';');
+    }
+    if (!(current & LTE_SHIELD_CONFIG_GPIO2))
+    {
+        appendCommand(cmd, LTE_SHIELD_COMMAND_GPIO);
+        appendCommand(cmd, '=');
+        appendCommandInt(cmd, GPIO2);
+        appendCommand(cmd, ',');
+        appendCommandInt(cmd, GNSS_SUPPLY_ENABLE);
+        appendCommand(cmd, ';');
+    }
+    if (!(current & LTE_SHIELD_CONFIG_CMGF))
+    {
+        appendCommand(cmd, LTE_SHIELD_MESSAGE_FORMAT);
+        appendCommand(cmd, "=1;");
+    }
+    if (!(current & LTE_SHIELD_CONFIG_CTZU))
+    {
+        appendCommand(cmd, LTE_SHIELD_COMMAND_AUTO_TZ);
+        appendCommand(cmd, "=1;");
+    }
+    if (cmd->commandLength == 0)
+        return; // Already configured, slot was never submitted
+    cmd->command[--cmd->commandLength] = '\0'; // Drop the trailing ';'
+
+    if (waitForCommand(submitCommand(cmd)) != LTE_SHIELD_ERROR_SUCCESS)
+    {
+        // One rejected setting aborts the rest of the line, fall back to applying them singly
+        enableErrorCodes(true);
+        setGpioMode(GPIO1, NETWORK_STATUS);
+        setGpioMode(GPIO2, GNSS_SUPPLY_ENABLE);
+        setSMSMessageFormat(LTE_SHIELD_MESSAGE_FORMAT_TEXT);
+        autoTimeZone(true);
+    }
+}
+
+void LTE_Shield::closeAllSockets(void)
+{
+    // The module can't list its open sockets, but closing one that isn't open
+    // now fails straight away on "+CME ERROR" instead of timing out
+    for (int i = 0; i < LTE_SHIELD_NUM_SOCKETS; i++)
+    {
+        socketClose(i, 100);
+    }
+}
+
+void LTE_Shield::powerOn(void)
+{
+    pinMode(_powerPin, OUTPUT);
+    digitalWrite(_powerPin, LOW);
+    delay(LTE_SHIELD_POWER_PULSE_PERIOD);
+    pinMode(_powerPin, INPUT); // Return to high-impedance, rely on SARA module internal pull-up
+}
+
+void LTE_Shield::hwReset(void)
+{
+    pinMode(_resetPin, OUTPUT);
+    digitalWrite(_resetPin, LOW);
+    delay(LTE_RESET_PULSE_PERIOD);
+    pinMode(_resetPin, INPUT); // Return to high-impedance, rely on SARA module internal pull-up
+}
+
+LTE_Shield_error_t LTE_Shield::functionality(LTE_Shield_functionality_t function)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_FUNC);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, function);
+
+    return waitForCommand(submitCommand(cmd));
+}
+
+LTE_Shield_error_t LTE_Shield::setMno(mobile_network_operator_t mno)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    appendCommand(cmd, LTE_SHIELD_COMMAND_MNO);
+    appendCommand(cmd, '=');
+    appendCommandInt(cmd, (uint8_t)mno);
+
+    return waitForCommand(submitCommand(cmd));
+}
+
+LTE_Shield_error_t LTE_Shield::getMno(mobile_network_operator_t *mno)
+{
+    return waitForCommand(getNetworkAsync(mno));
+}
+
+LTE_Shield::LTE_Shield_command_t *LTE_Shield::allocateCommand(const char *expectedResponse,
+                                                              unsigned long timeout,
+                                                              LTE_Shield_command_callback_t callback)
+{
+    LTE_Shield_command_t *cmd = NULL;
+
+    // Prefer an unused slot, otherwise recycle the oldest completed command
+    for (int i = 0; i < LTE_SHIELD_MAX_PENDING_COMMANDS; i++)
+    {
+        if (_commands[i].state == LTE_SHIELD_COMMAND_FREE)
+        {
+            cmd = &_commands[i];
+            break;
+        }
+        if ((_commands[i].state == LTE_SHIELD_COMMAND_COMPLETE) &&
+            ((cmd == NULL) || (commandAge(&_commands[i]) > commandAge(cmd))))
+        {
+            cmd = &_commands[i];
+        }
+    }
+    if (cmd == NULL)
+        return NULL;
+
+    // Slot stays free until submitCommand(), so callers can simply bail out on error
+    memset(cmd, 0, sizeof(LTE_Shield_command_t));
+    cmd->at = true;
+    cmd->expectedResponse = expectedResponse;
+    cmd->timeout = timeout;
+    cmd->callback = callback;
+    cmd->response = _responseBuffer;
+    cmd->responseSize = sizeof(_responseBuffer);
+    return cmd;
+}
+
+void LTE_Shield::appendCommand(LTE_Shield_command_t *cmd, const char *str)
+{
+    while (*str != '\0')
+    {
+        appendCommand(cmd, *str++);
+    }
+}
+
+void LTE_Shield::appendCommand(LTE_Shield_command_t *cmd, char c)
+{
+    if (cmd->commandLength >= sizeof(cmd->command) - 1)
+    {
+        cmd->commandOverflow = true; // Caught by submitCommand()
+        return;
+    }
+    cmd->command[cmd->commandLength++] = c;
+    cmd->command[cmd->commandLength] = '\0';
+}
+
+void LTE_Shield::appendCommandInt(LTE_Shield_command_t *cmd, long value)
+{
+    if (value < 0)
+    {
+        appendCommand(cmd, '-');
+        value = -value;
+    }
+    appendCommandUnsigned(cmd, (unsigned long)value);
+}
+
+void LTE_Shield::appendCommandUnsigned(LTE_Shield_command_t *cmd, unsigned long value)
+{
+    char digits[10]; // Enough for a 32-bit unsigned long
+    int i = 0;
+
+    // Digits come out least-significant first
+    do
+    {
+        digits[i++] = '0' + (value % 10);
+        value /= 10;
+    } while ((value > 0) && (i < (int)sizeof(digits)));
+
+    while (i > 0)
+    {
+        appendCommand(cmd, digits[--i]);
+    }
+}
+
+void LTE_Shield::appendCommandQuoted(LTE_Shield_command_t *cmd, const char *str)
+{
+    // A long host name, APN or number that won't fit is written from the caller's string
+    // when the command goes out, like a payload. One per command, the rest must still fit.
+    if ((cmd->argument == NULL) &&
+        (cmd->commandLength + strlen(str) + 2 + LTE_SHIELD_COMMAND_TAIL >= sizeof(cmd->command)))
+    {
+        cmd->argument = str;
+        cmd->argumentAt = cmd->commandLength;
+        return;
+    }
+    appendCommand(cmd, '\"');
+    appendCommand(cmd, str);
+    appendCommand(cmd, '\"');
+}
+
+int LTE_Shield::submitCommand(LTE_Shield_command_t *cmd)
+{
+    if (cmd->commandOverflow)
+        return -LTE_SHIELD_ERROR_UNEXPECTED_PARAM; // Command didn't fit, slot is still free
+    if (_directLink)
+        return -LTE_SHIELD_ERROR_INVALID; // It would go down the socket as data
+
+    cmd->handle = _nextHandle;
+    _nextHandle = (_nextHandle + 1) & LTE_SHIELD_HANDLE_MASK;
+    cmd->state = LTE_SHIELD_COMMAND_QUEUED;
+
+    if ((_activeCommand == NULL) && !_asleep)
+    {
+        // Modem is idle, get the command onto the wire right away
+        startCommand(nextQueuedCommand());
+    }
+    return cmd->handle;
+}
+
+LTE_Shield::LTE_Shield_command_t *LTE_Shield::findCommand(int handle)
+{
+    if (handle < 0)
+        return NULL;
+
+    for (int i = 0; i < LTE_SHIELD_MAX_PENDING_COMMANDS; i++)
+    {
+        if ((_commands[i].state != LTE_SHIELD_COMMAND_FREE) && (_commands[i].handle == handle))
+        {
+            return &_commands[i];
+        }
+    }
+    return NULL;
+}
+
+LTE_Shield::LTE_Shield_command_t *LTE_Shield::nextQueuedCommand(void)
+{
+    LTE_Shield_command_t *next = NULL;
+
+    for (int i = 0; i < LTE_SHIELD_MAX_PENDING_COMMANDS; i++)
+    {
+        if ((_commands[i].state == LTE_SHIELD_COMMAND_QUEUED) &&
+            ((next == NULL) || (commandAge(&_commands[i]) > commandAge(next))))
+        {
+            next = &_commands[i];
+        }
+    }
+    return next;
+}
+
+unsigned int LTE_Shield::commandAge(LTE_Shield_command_t *cmd)
+{
+    // Handles wrap, so compare how far behind the next handle each one is
+    return (_nextHandle - cmd->handle) & LTE_SHIELD_HANDLE_MASK;
+}
+
+void LTE_Shield::startCommand(LTE_Shield_command_t *cmd)
+{
+    _activeCommand = cmd;
+    _commandsSent++;
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+    cmd->sentTime = millis();
+#endif
+
+    if ((cmd->prompt == NULL) && (cmd->payload != NULL))
+    {
+        // No prompt to wait for, the payload finishes off the command line
+        sendCommandLine(cmd, false);
+        sendPayload(cmd);
+        hwPrint("\r");
+    }
+    else
+    {
+        sendCommandLine(cmd, true);
+    }
+
+    cmd->state = (cmd->prompt != NULL) ? LTE_SHIELD_COMMAND_WAIT_PROMPT : LTE_SHIELD_COMMAND_WAIT_RESPONSE;
+    cmd->matchIndex = 0;
+    cmd->charsRead = 0;
+    cmd->responseLength = 0;
+    cmd->responseOverflow = false;
+    cmd->lineOverflow = false;
+    cmd->recordOverflow = false;
+    cmd->lineStart = 0;
+    if (cmd->response != NULL)
+    {
+        cmd->response[0] = '\0';
+    }
+    cmd->startTime = millis();
+}
+
+void LTE_Shield::processCommands(void)
+{
+    LTE_Shield_command_t *cmd;
+    unsigned long timeout;
+
+    while (true)
+    {
+        if (_activeCommand == NULL)
+        {
+            if (_asleep)
+            {
+                // Hold the queue until +UUPSMR says it's awake, or a wake() has had long enough
+                if (!_wakeRequested || (millis() - _wakeTime < LTE_SHIELD_WAKE_TIMEOUT))
+                    return;
+                _asleep = false;
+                _wakeRequested = false;
+            }
+            cmd = nextQueuedCommand();
+            if (cmd == NULL)
+                return; // Nothing left to do
+            startCommand(cmd);
+        }
+        cmd = _activeCommand;
+
+        while (_activeCommand == cmd)
+        {
+            if (_rxHead == _rxTail)
+            {
+                fillRxBuffer();
+                if (_rxHead == _rxTail)
+                    break; // Nothing more from the modem yet
+            }
+            processCommandChar(cmd, rxRead());
+        }
+        if (_activeCommand != cmd)
+            continue; // Finished, move on to the next command
+
+        timeout = (cmd->state == LTE_SHIELD_COMMAND_WAIT_PROMPT) ? LTE_SHIELD_STANDARD_RESPONSE_TIMEOUT : cmd->timeout;
+        if (millis() - cmd->startTime < timeout)
+            return; // Still waiting on the modem
+
+        completeCommand(cmd, (cmd->charsRead == 0) ? LTE_SHIELD_ERROR_NO_RESPONSE : LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE);
+    }
+}
+
+void LTE_Shield::processCommandChar(LTE_Shield_command_t *cmd, char c)
+{
+    const char *target;
+
+    cmd->charsRead++;
+    if (cmd->inData)
+    {
+        // Quoted data goes straight to its destination, and can't be mistaken for "OK"
+        if (cmd->hex)
+        {
+            // Two digits per byte, decoded in place as they arrive
+            size_t index = cmd->dataIndex >> 1;
+            if (index < cmd->dataSize)
+            {
+                if (cmd->dataIndex & 1)
+                    cmd->dataDest[index] |= hexNibble(c);
+                else
+                    cmd->dataDest[index] = hexNibble(c) << 4;
+            }
+            if ((++cmd->dataIndex >> 1) >= cmd->dataLength)
+            {
+                cmd->inData = false;
+            }
+        }
+        else
+        {
+            if (cmd->dataIndex < cmd->dataSize)
+            {
+                cmd->dataDest[cmd->dataIndex] = c;
+            }
+            if (++cmd->dataIndex >= cmd->dataLength)
+            {
+                cmd->inData = false;
+            }
+        }
+        return;
+    }
+    if ((cmd->response != NULL) && (cmd->responseLength < cmd->responseSize - 1))
+    {
+        cmd->response[cmd->responseLength++] = c;
+        cmd->response[cmd->responseLength] = '\0';
+    }
+    else
+    {
+        cmd->lineOverflow = true;
+        cmd->recordOverflow = true;
+    }
+    if ((cmd->recordParser != NULL) && (c == cmd->recordDelimiter) &&
+        (cmd->state == LTE_SHIELD_COMMAND_WAIT_RESPONSE))
+    {
+        // Hand over the finished record and reuse the buffer for the next one
+        if (!cmd->recordOverflow)
+        {
+            cmd->recordParser(cmd->response, cmd->results, cmd->resultArg);
+        }
+        if (cmd->recordOverflow)
+        {
+            cmd->responseOverflow = true; // Skipped, the rest are still parsed
+        }
+        cmd->responseLength = 0;
+        cmd->response[0] = '\0';
+        cmd->recordOverflow = false;
+        cmd->lineOverflow = false;
+        cmd->lineStart = 0;
+    }
+    if ((cmd->dataDest != NULL) && !cmd->dataDone && (c == '\"') &&
+        (cmd->state == LTE_SHIELD_COMMAND_WAIT_RESPONSE))
+    {
+        if (cmd->dataSkipQuotes > 0)
+        {
+            cmd->dataSkipQuotes--;
+        }
+        else
+        {
+            startCommandData(cmd);
+            return;
+        }
+    }
+    if (assembleLine(c))
+    {
+        // Don't sit out the timeout if the modem has already refused the command
+        LTE_Shield_error_t err = checkFinalResult(_rxLine);
+        if (err != LTE_SHIELD_ERROR_SUCCESS)
+        {
+            completeCommand(cmd, err);
+            return;
+        }
+        if (!isCommandReply(cmd, _rxLine) && queueUrcLine(_rxLine) &&
+            (cmd->lineStart <= cmd->responseLength))
+        {
+            // Keep the URC out of the command's own response
+            cmd->responseLength = cmd->lineStart;
+            cmd->response[cmd->responseLength] = '\0';
+            cmd->lineOverflow = false; // The URC queue has its own limit
+        }
+    }
+    if (c == '\n')
+    {
+        cmd->lineStart = cmd->responseLength;
+        if (cmd->lineOverflow)
+        {
+            cmd->responseOverflow = true;
+            cmd->lineOverflow = false;
+        }
+    }
+
+    target = (cmd->state == LTE_SHIELD_COMMAND_WAIT_PROMPT) ? cmd->prompt : cmd->expectedResponse;
+    if (c == target[cmd->matchIndex])
+    {
+        cmd->matchIndex++;
+    }
+    else
+    {
+        cmd->matchIndex = (c == target[0]) ? 1 : 0;
+    }
+    if (target[cmd->matchIndex] != '\0')
+        return; // Not there yet
+
+    if (cmd->state == LTE_SHIELD_COMMAND_WAIT_PROMPT)
+    {
+        // Got the prompt, send the payload then wait for the final response
+        sendPayload(cmd);
+        cmd->state = LTE_SHIELD_COMMAND_WAIT_RESPONSE;
+        cmd->matchIndex = 0;
+        cmd->responseLength = 0;
+        cmd->responseOverflow = false;
+        cmd->lineOverflow = false;
+        cmd->recordOverflow = false;
+        cmd->lineStart = 0;
+        cmd->startTime = millis();
+    }
+    else
+    {
+        completeCommand(cmd, LTE_SHIELD_ERROR_SUCCESS);
+    }
+}
+
+boolean LTE_Shield::isCommandReply(LTE_Shield_command_t *cmd, const char *line)
+{
+    const char *colon;
+    size_t prefixLength;
+    char next;
+
+    // e.g. "+CREG: 0,1" answers AT+CREG? even though +CREG is also a URC
+    colon = strchr(line, ':');
+    if (colon == NULL)
+        return false;
+    prefixLength = colon - line;
+    if (strncmp(cmd->command, line, prefixLength) != 0)
+        return false;
+    next = cmd->command[prefixLength];
+    return (next == '\0') || (next == '=') || (next == '?') || (next == ';');
+}
+
+LTE_Shield_error_t LTE_Shield::checkFinalResult(const char *line)
+{
+    if (strncmp(line, LTE_SHIELD_RESPONSE_CME_ERROR, strlen(LTE_SHIELD_RESPONSE_CME_ERROR)) == 0)
+    {
+        _lastErrorCode = atoi(line + strlen(LTE_SHIELD_RESPONSE_CME_ERROR));
+        return LTE_SHIELD_ERROR_CME_ERROR;
+    }
+    if (strncmp(line, LTE_SHIELD_RESPONSE_CMS_ERROR, strlen(LTE_SHIELD_RESPONSE_CMS_ERROR)) == 0)
+    {
+        _lastErrorCode = atoi(line + strlen(LTE_SHIELD_RESPONSE_CMS_ERROR));
+        return LTE_SHIELD_ERROR_CMS_ERROR;
+    }
+    for (size_t i = 0; i < sizeof(LTE_SHIELD_FINAL_RESULTS) / sizeof(LTE_SHIELD_FINAL_RESULTS[0]); i++)
+    {
+        if (strcmp(line, LTE_SHIELD_FINAL_RESULTS[i].line) == 0)
+        {
+            return LTE_SHIELD_FINAL_RESULTS[i].err;
+        }
+    }
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+void LTE_Shield::sendCommandLine(LTE_Shield_command_t *cmd, boolean terminate)
+{
+    char split;
+
+    if (cmd->argument == NULL)
+    {
+        sendCommand(cmd->command, cmd->at, terminate);
+        return;
+    }
+
+    // Everything before the long argument, the argument, then the rest
+    split = cmd->command[cmd->argumentAt];
+    cmd->command[cmd->argumentAt] = '\0';
+    sendCommand(cmd->command, cmd->at, false);
+    cmd->command[cmd->argumentAt] = split;
+    hwWrite('\"');
+    hwPrint(cmd->argument);
+    hwWrite('\"');
+    hwPrint(&cmd->command[cmd->argumentAt]);
+    if (terminate)
+    {
+        hwPrint("\r");
+    }
+}
+
+void LTE_Shield::startCommandData(LTE_Shield_command_t *cmd)
+{
+    const char *lengthField;
+
+    // The field just before the opening quote gives the data length,
+    // e.g. +USORD: 0,5,"hello"
+    lengthField = &cmd->response[cmd->responseLength - 1];
+    if ((lengthField > cmd->response) && (lengthField[-1] == ','))
+        lengthField--;
+    while ((lengthField > cmd->response) && isdigit(lengthField[-1]))
+        lengthField--;
+
+    cmd->dataLength = atol(lengthField);
+    cmd->dataIndex = 0;
+    cmd->dataDone = true;
+    cmd->inData = (cmd->dataLength > 0);
+}
+
+void LTE_Shield::sendPayload(LTE_Shield_command_t *cmd)
+{
+    if (cmd->hex)
+    {
+        for (size_t i = 0; i < cmd->payloadLength; i++)
+        {
+            uint8_t b = (uint8_t)cmd->payload[i];
+            hwWrite(LTE_SHIELD_HEX_DIGITS[b >> 4]);
+            hwWrite(LTE_SHIELD_HEX_DIGITS[b & 0x0F]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < cmd->payloadLength; i++)
+        {
+            hwWrite(cmd->payload[i]);
+        }
+    }
+    if (cmd->payloadTerminator != 0)
+    {
+        hwWrite(cmd->payloadTerminator);
+    }
+}
+
+void LTE_Shield::completeCommand(LTE_Shield_command_t *cmd, LTE_Shield_error_t err)
+{
+    if (_activeCommand == cmd)
+    {
+        _activeCommand = NULL;
+    }
+
+    if ((err == LTE_SHIELD_ERROR_SUCCESS) && (cmd->dataDest != NULL))
+    {
+        if (!cmd->dataDone)
+        {
+            err = LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+        }
+        else if (cmd->results[0] != NULL)
+        {
+            *((int *)cmd->results[0]) = (cmd->dataLength < cmd->dataSize) ? cmd->dataLength : cmd->dataSize;
+        }
+    }
+
+    // A parser handed a cut-short response would take it for the whole thing
+    if (cmd->lineOverflow)
+    {
+        cmd->responseOverflow = true;
+    }
+    if ((err == LTE_SHIELD_ERROR_SUCCESS) && cmd->responseOverflow &&
+        (cmd->strictCapture || (cmd->parser != NULL) || (cmd->recordParser != NULL)))
+    {
+        err = LTE_SHIELD_ERROR_RESPONSE_OVERFLOW;
+    }
+    if ((err == LTE_SHIELD_ERROR_SUCCESS) && (cmd->parser != NULL))
+    {
+        err = cmd->parser(cmd->response, cmd->results, cmd->resultArg);
+    }
+    cmd->result = err;
+    cmd->state = LTE_SHIELD_COMMAND_COMPLETE;
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+    recordCommandStats(cmd, err);
+#endif
+
+    if (cmd->callback != NULL)
+    {
+        cmd->callback(cmd->handle, err);
+    }
+}
+
+/*LTE_Shield_error_t LTE_Shield::sendCommandWithResponseAndTimeout(const char * command,
+    char * expectedResponse, uint16_t commandTimeout, boolean at)
+{
+    unsigned long timeIn = millis();
+    char * response;
+
+    sendCommand(command, at);
+
+    // Wait until we've receved the requested number of characters
+    while (hwAvailable() < strlen(expectedResponse))
+    {
+        if (millis() > timeIn + commandTimeout)
+        {
+            return LTE_SHIELD_ERROR_TIMEOUT;
+        }
+    }
+    response = lte_calloc_char(hwAvailable() + 1);
+    if (response == NULL)
+    {
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    }
+    readAvailable(response);
+
+    // Check for expected response
+    if (strcmp(response, expectedResponse) == 0)
+    {
+        return LTE_SHIELD_ERROR_SUCCESS;
+    }
+    return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+}*/
+
+
+LTE_Shield_error_t LTE_Shield::sendCommandWithResponse(
+    const char *command, const char *expectedResponse, char *responseDest, size_t destSize,
+    unsigned long commandTimeout, boolean at)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(expectedResponse, commandTimeout, NULL);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    if (command != NULL)
+    {
+        appendCommand(cmd, command);
+    }
+    cmd->at = at;
+    if ((responseDest != NULL) && (destSize > 0))
+    {
+        cmd->response = responseDest;
+        cmd->responseSize = destSize;
+        cmd->strictCapture = true;
+    }
+
+    return waitForCommand(submitCommand(cmd));
+}
+
+boolean LTE_Shield::sendCommand(const char *command, boolean at, boolean terminate)
+{
+    // Anything already waiting is unsolicited, keep the URCs for the next poll().
+    // A partial line is left in _rxLine to be finished off by the bytes that follow.
+    fillRxBuffer();
+    while (_rxHead != _rxTail)
+    {
+        if (assembleLine(rxRead()))
+        {
+            queueUrcLine(_rxLine);
+        }
+        if (_rxHead == _rxTail)
+        {
+            fillRxBuffer();
+        }
+    }
+
+    if (at)
+    {
+        hwPrint(LTE_SHIELD_COMMAND_AT);
+        hwPrint(command);
+        if (terminate)
+        {
+            hwPrint("\r");
+        }
+    }
+    else
+    {
+        hwPrint(command);
+    }
+
+    return true;
+}
+
+int LTE_Shield::findUrcHandler(const char *line, const char **params)
+{
+    const int builtIns = sizeof(_urcHandlers) / sizeof(_urcHandlers[0]);
+    const char *colon;
+    size_t prefixLength;
+
+    // Every URC we know about is "+PREFIX: params", skip anything else without scanning it
+    if (line[0] != '+')
+        return -1;
+    colon = strchr(line, ':');
+    if (colon == NULL)
+        return -1;
+    prefixLength = colon - line;
+    if (params != NULL)
+    {
+        colon++;
+        while (*colon == ' ')
+            colon++;
+        *params = colon;
+    }
+
+    // Built-in handlers come first, then user handlers numbered on from them
+    for (int i = 0; i < builtIns; i++)
+    {
+        if ((strncmp(_urcHandlers[i].prefix, line, prefixLength) == 0) &&
+            (_urcHandlers[i].prefix[prefixLength] == '\0'))
+        {
+            return i;
+        }
+    }
+    for (int i = 0; i < LTE_SHIELD_MAX_URC_HANDLERS; i++)
+    {
+        if ((_userUrcHandlers[i].handler != NULL) &&
+            (strncmp(_userUrcHandlers[i].prefix, line, prefixLength) == 0) &&
+            (_userUrcHandlers[i].prefix[prefixLength] == '\0'))
+        {
+            return builtIns + i;
+        }
+    }
+    return -1;
+}
+
+boolean LTE_Shield::processUrcLine(const char *line)
+{
+    const int builtIns = sizeof(_urcHandlers) / sizeof(_urcHandlers[0]);
+    const char *params;
+    int handler;
+
+    handler = findUrcHandler(line, &params);
+    if (handler < 0)
+        return false;
+    if (handler < builtIns)
+        return (this->*_urcHandlers[handler].handler)(params);
+
+    _userUrcHandlers[handler - builtIns].handler(params);
+    return true;
+}
+
+boolean LTE_Shield::queueUrcLine(const char *line)
+{
+    size_t length;
+
+    if (findUrcHandler(line, NULL) < 0)
+        return false; // Not a URC, or nobody is listening for it
+
+    // Hold it for the next poll(), when no command is in the way
+    length = strlen(line) + 1;
+    if (_urcQueueLength + length > sizeof(_urcQueue))
+    {
+        _droppedUrcs++;
+        return true;
+    }
+    memcpy(&_urcQueue[_urcQueueLength], line, length);
+    _urcQueueLength += length;
+    return true;
+}
+
+boolean LTE_Shield::processUrcQueue(void)
+{
+    char line[LTE_SHIELD_RX_LINE_SIZE];
+    size_t length;
+    boolean handled = false;
+
+    // Handlers may run commands that queue more URCs, so take them one at a time
+    while ((_urcQueueLength > 0) && (_activeCommand == NULL))
+    {
+        length = strlen(_urcQueue) + 1;
+        memcpy(line, _urcQueue, length);
+        _urcQueueLength -= length;
+        memmove(_urcQueue, &_urcQueue[length], _urcQueueLength);
+        if (processUrcLine(line))
+        {
+            handled = true;
+        }
+    }
+    return handled;
+}
+
+boolean LTE_Shield::urcSocketRead(const char *params)
+{
+    int socket, length;
+
+    if (sscanf(params, "%d,%d", &socket, &length) != 2)
+        return false;
+
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS) && (length >= 0))
+    {
+        _socketUnread[socket] = length; // The total waiting, not what just arrived
+        if (_socketFlags[socket] & LTE_SHIELD_SOCKET_DEFERRED)
+            return true;
+    }
+    // Each read counts itself off _socketUnread. SARA-R4 won't announce the data again, so
+    // whatever can't be fetched now (every command slot taken, say) is left there for
+    // socketAvailable() and socketReadAll().
+    parseSocketReadIndication(socket, length);
+    return true;
+}
+
+boolean LTE_Shield::urcSocketRecvFrom(const char *params)
+{
+    int socket, length;
+
+    if (sscanf(params, "%d,%d", &socket, &length) != 2)
+        return false;
+
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS) && (length >= 0))
+    {
+        _socketUnread[socket] = length; // Cleared by the +USORF that fetches it, as above
+        if (_socketFlags[socket] & LTE_SHIELD_SOCKET_DEFERRED)
+            return true;
+    }
+    parseSocketRecvFromIndication(socket, length);
+    return true;
+}
+
+boolean LTE_Shield::urcSocketListen(const char *params)
+{
+    int socket, listenSocket;
+    unsigned int port, listenPort;
+    int remote[4], local[4];
+    IPAddress remoteIP, localIP;
+
+    if (sscanf(params, "%d,\"%d.%d.%d.%d\",%u,%d,\"%d.%d.%d.%d\",%u",
+               &socket,
+               &remote[0], &remote[1], &remote[2], &remote[3],
+               &port, &listenSocket,
+               &local[0], &local[1], &local[2], &local[3],
+               &listenPort) <= 4)
+    {
+        return false;
+    }
+
+    for (int octet = 0; octet < 4; octet++)
+    {
+        remoteIP[octet] = (uint8_t)remote[octet];
+        localIP[octet] = (uint8_t)local[octet];
+    }
+    parseSocketListenIndication(localIP, remoteIP);
+    return true;
+}
+
+boolean LTE_Shield::urcSocketClose(const char *params)
+{
+    int socket;
+
+    if (sscanf(params, "%d", &socket) != 1)
+        return false;
+
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
+    {
+        // Anything still unread went with it
+        _socketFlags[socket] |= LTE_SHIELD_SOCKET_CLOSED;
+        _socketUnread[socket] = 0;
+        if (_socketCloseCallback != NULL)
+        {
+            _socketCloseCallback(socket);
+        }
+    }
+    return true;
+}
+
+boolean LTE_Shield::urcSocketConnect(const char *params)
+{
+    int socket, error;
+    unsigned long elapsed = 0;
+
+    // e.g. +UUSOCO: 0,0 once connected, +UUSOCO: 0,<socket error> if not
+    if (sscanf(params, "%d,%d", &socket, &error) != 2)
+        return false;
+
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS) &&
+        (_socketFlags[socket] & LTE_SHIELD_SOCKET_CONNECTING))
+    {
+        _socketFlags[socket] &= ~LTE_SHIELD_SOCKET_CONNECTING;
+        elapsed = millis() - _socketConnectStart[socket];
+    }
+    if (_socketConnectCallback != NULL)
+    {
+        _socketConnectCallback(socket, error, elapsed);
+    }
+    return true;
+}
+
+boolean LTE_Shield::urcLocation(const char *params)
+{
+    ClockData clck;
+    PositionData gps;
+    SpeedData spd;
+    unsigned long uncertainty;
+    int scanNum;
+    unsigned int latH, lonH, altU, speedU, trackU;
+    char latL[10], lonL[10];
+
+    // Found a Location string!
+    scanNum = sscanf(params,
+                     "%hhu/%hhu/%u,%hhu:%hhu:%hhu.%u,%u.%9[^,],%u.%9[^,],%u,%lu,%u,%u,*%*s",
+                     &clck.date.day, &clck.date.month, &clck.date.year,
+                     &clck.time.hour, &clck.time.minute, &clck.time.second, &clck.time.ms,
+                     &latH, latL, &lonH, lonL, &altU, &uncertainty,
+                     &speedU, &trackU);
+    if (scanNum < 13)
+        return false; // Break out if we didn't find enough
+
+    gps.lat = (float)latH + ((float)atol(latL) / pow(10, strlen(latL)));
+    gps.lon = (float)lonH + ((float)atol(lonL) / pow(10, strlen(lonL)));
+    gps.alt = (float)altU;
+    if (scanNum == 15) // If detailed response, get speed data
+    {
+        spd.speed = (float)speedU;
+        spd.track = (float)trackU;
+    }
+
+    if (_gpsRequestCallback != NULL)
+    {
+        _gpsRequestCallback(clck, gps, spd, uncertainty);
+    }
+    return true;
+}
+
+boolean LTE_Shield::urcPowerSaving(const char *params)
+{
+    int state;
+
+    // +UUPSMR: 0 woke up, 1 entering PSM, 2 PSM entry blocked
+    if (sscanf(params, "%d", &state) != 1)
+        return false;
+
+    if ((state == 1) != _asleep)
+    {
+        _asleep = (state == 1);
+        _wakeRequested = false;
+        if (_sleepCallback != NULL)
+        {
+            _sleepCallback(_asleep);
+        }
+    }
+    return true;
+}
+
+LTE_Shield_error_t LTE_Shield::parseSocketReadIndication(int socket, int length)
+{
+    char readDest[LTE_SHIELD_SOCKET_READ_CHUNK + 1];
+    int readTotal;
+
+    if ((socket < 0) || (length < 0))
+    {
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    }
+
+    // Each chunk is handed to the callbacks as it arrives, readDest is reused for every one
+    readTotal = drainSocket(socket, length, readDest, LTE_SHIELD_SOCKET_READ_CHUNK, NULL);
+    return (readTotal < 0) ? (LTE_Shield_error_t)(-readTotal) : LTE_SHIELD_ERROR_SUCCESS;
+}
+
+LTE_Shield_error_t LTE_Shield::parseSocketRecvFromIndication(int socket, int length)
+{
+    LTE_Shield_error_t err;
+    char chunk[LTE_SHIELD_SOCKET_READ_CHUNK + 1];
+    char *readDest = chunk;
+    int readLength = LTE_SHIELD_SOCKET_READ_CHUNK;
+    IPAddress remoteIP;
+    unsigned int remotePort;
+
+    if ((socket < 0) || (length < 0))
+    {
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    }
+    if (length == 0)
+        return LTE_SHIELD_ERROR_SUCCESS;
+
+    // Unlike +USORD, the datagram has to come in one read: SARA-R4 drops whatever a
+    // +USORF leaves behind. The module announces the next datagram once this one's gone.
+    if (_recvFromBuffer != NULL)
+    {
+        readDest = (char *)_recvFromBuffer;
+        readLength = (int)_recvFromBufferSize;
+    }
+    if (readLength > length)
+        readLength = length;
+    err = waitForCommand(socketRecvFromAsync(socket, readLength, readDest, &readLength, &remoteIP, &remotePort));
+    if ((err != LTE_SHIELD_ERROR_SUCCESS) || (readLength <= 0))
+        return err;
+
+    if (_socketRecvFromCallback != NULL)
+    {
+        _socketRecvFromCallback(socket, (const uint8_t *)readDest, readLength, remoteIP, remotePort);
+    }
+    if (_socketDataCallback != NULL)
+    {
+        _socketDataCallback(socket, (const uint8_t *)readDest, readLength);
+    }
+    if (_socketReadCallback != NULL)
+    {
+        readDest[readLength] = '\0';
+        _socketReadCallback(socket, String(readDest));
+    }
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+LTE_Shield_error_t LTE_Shield::parseSocketListenIndication(IPAddress localIP, IPAddress remoteIP)
+{
+    _lastLocalIP = localIP;
+    _lastRemoteIP = remoteIP;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+LTE_Shield_error_t LTE_Shield::parseSocketCloseIndication(String *closeIndication)
+{
+    LTE_Shield_error_t err;
+    int search;
+    int socket;
+
+    search = closeIndication->indexOf("UUSOCL: ") + strlen("UUSOCL: ");
+
+    // Socket will be first integer, should be single-digit number between 0-6:
+    socket = closeIndication->substring(search, search + 1).toInt();
+
+    if (_socketCloseCallback != NULL)
+    {
+        _socketCloseCallback(socket);
+    }
+
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+size_t LTE_Shield::hwPrint(const char *s)
+{
+#if LTE_SHIELD_ENABLE_TRACE
+    if (_traceEnabled)
+    {
+        for (const char *c = s; *c != '\0'; c++)
+        {
+            traceRecord(true, *c);
+        }
+    }
+#endif
+    return _serialPort->print(s);
+}
+
+size_t LTE_Shield::hwWrite(const char c)
+{
+#if LTE_SHIELD_ENABLE_TRACE
+    if (_traceEnabled)
+        traceRecord(true, c);
+#endif
+    return _serialPort->write(c);
+}
+
+int LTE_Shield::readAvailable(char *inString)
+{
+    int len = 0;
+
+    while (_serialPort->available())
+    {
+        char c = readChar();
+        if (inString != NULL)
+        {
+            inString[len++] = c;
+        }
+    }
+    if (inString != NULL)
+    {
+        inString[len] = 0;
+    }
+
+    return len;
+}
+
+char LTE_Shield::readChar(void)
+{
+    char c = (char)_serialPort->read();
+
+#if LTE_SHIELD_ENABLE_TRACE
+    if (_traceEnabled)
+        traceRecord(false, c);
+#endif
+    return c;
+}
+
+int LTE_Shield::hwAvailable(void)
+{
+    if (_serialPort == NULL)
+        return -1; // Not begun yet
+
+    return _serialPort->available();
+}
+
+#if LTE_SHIELD_ENABLE_TRACE
+void LTE_Shield::traceEnable(boolean enable)
+{
+    if (enable && !_traceEnabled)
+        _traceLastTime = micros();
+    _traceEnabled = enable;
+}
+
+void LTE_Shield::traceClear(void)
+{
+    _traceHead = 0;
+    _traceTail = 0;
+    _traceLastTime = micros();
+}
+
+size_t LTE_Shield::traceLength(void)
+{
+    return (_traceHead + LTE_SHIELD_TRACE_SIZE - _traceTail) % LTE_SHIELD_TRACE_SIZE;
+}
+
+size_t LTE_Shield::traceCopy(uint8_t *dest, size_t size)
+{
+    unsigned int index = _traceTail;
+    unsigned int recordLength;
+    size_t copied = 0;
+
+    while (index != _traceHead)
+    {
+        recordLength = traceRecordLength(index);
+        if (copied + recordLength > size)
+            break;
+        for (unsigned int i = 0; i < recordLength; i++)
+        {
+            dest[copied++] = _trace[index];
+            index = (index + 1) % LTE_SHIELD_TRACE_SIZE;
+        }
+    }
+    return copied;
+}
+
+void LTE_Shield::traceDump(Print &out)
+{
+    unsigned int index = _traceTail;
+    uint8_t column = 0;
+
+    out.print(F("# LTE_Shield trace, "));
+    out.print(traceLength());
+    out.println(F(" bytes"));
+    while (index != _traceHead)
+    {
+        if (_trace[index] < 0x10)
+            out.print('0');
+        out.print(_trace[index], HEX);
+        index = (index + 1) % LTE_SHIELD_TRACE_SIZE;
+        if ((++column == 32) || (index == _traceHead))
+        {
+            out.println();
+            column = 0;
+        }
+    }
+}
+
+void LTE_Shield::traceRecord(boolean tx, uint8_t c)
+{
+    uint8_t record[7];
+    unsigned int length = 0;
+    unsigned long now = micros();
+    unsigned long delta = now - _traceLastTime;
+
+    _traceLastTime = now;
+
+    record[length] = (tx ? LTE_SHIELD_TRACE_TX : 0) | (delta & LTE_SHIELD_TRACE_DELTA_MASK);
+    delta >>= 6;
+    if (delta != 0)
+        record[length] |= LTE_SHIELD_TRACE_EXTENDED;
+    length++;
+    while (delta != 0)
+    {
+        record[length] = delta & 0x7F;
+        delta >>= 7;
+        if (delta != 0)
+            record[length] |= 0x80;
+        length++;
+    }
+    record[length++] = c;
+
+    // Drop the oldest records until this one fits
+    while (LTE_SHIELD_TRACE_SIZE - 1 - traceLength() < length)
+    {
+        _traceTail = (_traceTail + traceRecordLength(_traceTail)) % LTE_SHIELD_TRACE_SIZE;
+    }
+    for (unsigned int i = 0; i < length; i++)
+    {
+        _trace[_traceHead] = record[i];
+        _traceHead = (_traceHead + 1) % LTE_SHIELD_TRACE_SIZE;
+    }
+}
+
+unsigned int LTE_Shield::traceRecordLength(unsigned int index)
+{
+    unsigned int length = 2; // Header and data
+
+    if (_trace[index] & LTE_SHIELD_TRACE_EXTENDED)
+    {
+        do
+        {
+            index = (index + 1) % LTE_SHIELD_TRACE_SIZE;
+            length++;
+        } while (_trace[index] & 0x80);
+    }
+    return length;
+}
+#endif
+
+void LTE_Shield::beginSerial(unsigned long baud)
+{
+    // Only place the concrete port type matters, a plain Stream is assumed to already be running
+    if (_hardSerial != NULL)
+    {
+        _hardSerial->begin(baud);
+    }
+#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
+    else if (_softSerial != NULL)
+    {
+        _softSerial->begin(baud);
+    }
+#endif
+    delay(100);
+}
+
+void LTE_Shield::setTimeout(unsigned long timeout)
+{
+    _serialPort->setTimeout(timeout);
+}
+
+bool LTE_Shield::find(char *target)
+{
+    return _serialPort->find(target);
+}
+
+void LTE_Shield::fillRxBuffer(void)
+{
+    unsigned int next;
+
+    while (hwAvailable() > 0)
+    {
+        next = (_rxHead + 1) % LTE_SHIELD_RX_BUFFER_SIZE;
+        if (next == _rxTail)
+            break; // Full, leave the rest in the UART until it's drained
+        _rxBuffer[_rxHead] = readChar();
+        _rxHead = next;
+    }
+}
+
+char LTE_Shield::rxRead(void)
+{
+    char c;
+
+    c = _rxBuffer[_rxTail];
+    _rxTail = (_rxTail + 1) % LTE_SHIELD_RX_BUFFER_SIZE;
+    return c;
+}
+
+boolean LTE_Shield::assembleLine(char c)
+{
+    if (c == '\n')
+    {
+        boolean complete = (_rxLineLength > 0) && !_rxLineOverflow;
+
+        // Lines too long for _rxLine are dropped rather than handed on truncated
+        _rxLine[_rxLineLength] = '\0';
+        _rxLineLength = 0;
+        _rxLineOverflow = false;
+        return complete;
+    }
+    if (c == '\r')
+        return false;
+
+    if (_rxLineLength < LTE_SHIELD_RX_LINE_SIZE - 1)
+    {
+        _rxLine[_rxLineLength++] = c;
+    }
+    else
+    {
+        _rxLineOverflow = true;
+    }
+    return false;
+}
+
+LTE_Shield_error_t LTE_Shield::autobaud(unsigned long desiredBaud)
+{
+    LTE_Shield_error_t err = LTE_SHIELD_ERROR_NO_RESPONSE;
+    unsigned long start = millis();
+    unsigned long found = 0;
+
+    // The rate the modem last answered at is the most likely, then walk the rest
+    if (supportedBaud(_storedBaud) && (probeBaud(_storedBaud) == LTE_SHIELD_ERROR_SUCCESS))
+    {
+        found = _storedBaud;
+    }
+    for (int pass = 0; (found == 0) && (pass < LTE_SHIELD_AUTOBAUD_PASSES); pass++)
+    {
+        for (int b = 0; (found == 0) && (b < NUM_SUPPORTED_BAUD); b++)
+        {
+            if ((pass == 0) && (LTE_SHIELD_SUPPORTED_BAUD[b] == _storedBaud))
+                continue; // Just tried it
+            if (probeBaud(LTE_SHIELD_SUPPORTED_BAUD[b]) == LTE_SHIELD_ERROR_SUCCESS)
+                found = LTE_SHIELD_SUPPORTED_BAUD[b];
+        }
+    }
+
+    if (found == desiredBaud)
+    {
+        err = LTE_SHIELD_ERROR_SUCCESS;
+    }
+    else if (found != 0)
+    {
+        setBaud(desiredBaud);
+        delay(200); // Give the modem time to switch
+        beginSerial(desiredBaud);
+        err = at();
+    }
+    else
+    {
+        beginSerial(desiredBaud); // Leave the port where the caller expects it
+    }
+    _initStats.autobaudDuration += millis() - start;
+    return err;
+}
+
+LTE_Shield_error_t LTE_Shield::ping(void)
+{
+    LTE_Shield_command_t *cmd;
+
+    cmd = allocateCommand(LTE_SHIELD_RESPONSE_OK, LTE_SHIELD_AUTOBAUD_TIMEOUT, NULL);
+    if (cmd == NULL)
+        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    return waitForCommand(submitCommand(cmd));
+}
+
+boolean LTE_Shield::waitForModem(unsigned long budget, boolean rebooted, struct RecoveryResult *result)
+{
+    unsigned long start = millis();
+    unsigned long backoff = LTE_SHIELD_RECOVERY_BACKOFF_MIN;
+
+    // Ping with a growing gap until it answers or the budget runs out
+    while (true)
+    {
+        result->pings++;
+        if (ping() == LTE_SHIELD_ERROR_SUCCESS)
+            return true;
+        if (millis() - start + backoff >= budget)
+            break;
+        delay(backoff);
+        backoff = (backoff * 2 > LTE_SHIELD_RECOVERY_BACKOFF_MAX) ? LTE_SHIELD_RECOVERY_BACKOFF_MAX : backoff * 2;
+    }
+
+    // A restart can bring the modem up at its default rate rather than ours
+    return rebooted && (autobaud(_baud) == LTE_SHIELD_ERROR_SUCCESS);
+}
+
+LTE_Shield_error_t LTE_Shield::probeBaud(unsigned long baud)
+{
+    beginSerial(baud);
+    _initStats.autobaudProbes++;
+    return ping();
+}
+
+// Response parsers:
+// Each takes the response captured for a command and fills in that command's
+// result pointers, see the matching *Async() method for what they point to.
+
+static LTE_Shield_error_t parseIdentityResponse(char *response, void **results, int arg)
+{
+    char id[21];
+
+    if (sscanf(response, "\r\n%20s\r\n", id) != 1)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    *((String *)results[0]) = String(id);
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static LTE_Shield_error_t parseCcidResponse(char *response, void **results, int arg)
+{
+    char ccid[21];
+
+    if (sscanf(response, "\r\n+CCID: %20s", ccid) != 1)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    *((String *)results[0]) = String(ccid);
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static LTE_Shield_error_t parseClockStringResponse(char *response, void **results, int arg)
+{
+    char *clockBegin;
+    char *clockEnd;
+
+    // Response format: \r\n+CCLK: "YY/MM/DD,HH:MM:SS-TZ"\r\n\r\nOK\r\n
+    clockBegin = strchr(response, '\"'); // Find first quote
+    if (clockBegin == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    clockBegin += 1;                     // Increment pointer to begin at first number
+    clockEnd = strchr(clockBegin, '\"'); // Find last quote
+    if (clockEnd == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    *(clockEnd) = '\0'; // Set last quote to null char -- end string
+
+    *((String *)results[0]) = String(clockBegin);
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static LTE_Shield_error_t parseClockResponse(char *response, void **results, int arg)
+{
+    struct ClockData *clk = (struct ClockData *)results[0];
+    int iy, imo, id, ih, imin, is, itz;
+
+    // Response format: \r\n+CCLK: "YY/MM/DD,HH:MM:SS-TZ"\r\n\r\nOK\r\n
+    if (sscanf(response, "\r\n+CCLK: \"%d/%d/%d,%d:%d:%d-%d\"\r\n",
+               &iy, &imo, &id, &ih, &imin, &is, &itz) != 7)
+    {
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    }
+
+    clk->date.year = iy;
+    clk->date.month = imo;
+    clk->date.day = id;
+    clk->time.hour = ih;
+    clk->time.minute = imin;
+    clk->time.second = is;
+    clk->time.ms = 0;
+    clk->time.tzh = itz;
+    clk->time.tzm = 0;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static LTE_Shield_error_t parseRssiResponse(char *response, void **results, int arg)
+{
+    int rssi;
+
+    if (sscanf(response, "\r\n+CSQ: %d,%*d", &rssi) != 1)
+    {
+        rssi = -1;
+    }
+
+    *((int8_t *)results[0]) = rssi;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static LTE_Shield_error_t parseRegistrationResponse(char *response, void **results, int arg)
+{
+    int status;
+
+    if (sscanf(response, "\r\n+CREG: %*d,%d", &status) != 1)
+    {
+        status = LTE_SHIELD_REGISTRATION_INVALID;
     }
-    readAvailable(response);
 
-    // Check for expected response
-    if (strcmp(response, expectedResponse) == 0)
+    *((LTE_Shield_registration_status_t *)results[0]) = (LTE_Shield_registration_status_t)status;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static LTE_Shield_error_t parseMnoResponse(char *response, void **results, int arg)
+{
+    mobile_network_operator_t *mno = (mobile_network_operator_t *)results[0];
+    const char *mno_keys = "0123456"; // Valid MNO responses
+    size_t i;
+
+    i = strcspn(response, mno_keys); // Find first occurence of MNO key
+    if (i == strlen(response))
     {
-        return LTE_SHIELD_ERROR_SUCCESS;
+        *mno = MNO_INVALID;
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
     }
-    return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
-}*/
+    *mno = (mobile_network_operator_t)(response[i] - 0x30); // Convert to integer
+
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
 
-LTE_Shield_error_t LTE_Shield::waitForResponse(const char *expectedResponse, uint16_t timeout)
+static LTE_Shield_error_t parseApnResponse(char *response, void **results, int arg)
 {
-    unsigned long timeIn;
-    boolean found = false;
-    int index = 0;
+    String *apn = (String *)results[0];
+    IPAddress *ip = (IPAddress *)results[1];
+    char *searchPtr;
+    int ipOctets[4];
 
-    timeIn = millis();
+    // Example: +CGDCONT: 1,"IP","hologram","10.170.241.191",0,0,0,0
+    searchPtr = strstr(response, "+CGDCONT: ");
+    if (searchPtr == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
 
-    while ((!found) && (timeIn + timeout > millis()))
+    searchPtr += strlen("+CGDCONT: ");
+    // Search to the third double-quote
+    for (int i = 0; (i < 3) && (searchPtr != NULL); i++)
+    {
+        searchPtr = strchr(++searchPtr, '\"');
+    }
+    if (searchPtr != NULL)
     {
-        if (hwAvailable())
+        // Fill in the APN:
+        searchPtr = strchr(searchPtr, '\"'); // Move to first quote
+        while ((*(++searchPtr) != '\"') && (*searchPtr != '\0'))
+        {
+            apn->concat(*(searchPtr));
+        }
+        // Now get the IP:
+        if (searchPtr != NULL)
         {
-            char c = readChar();
-            if (c == expectedResponse[index])
+            int scanned = sscanf(searchPtr, "\",\"%d.%d.%d.%d\"",
+                                 &ipOctets[0], &ipOctets[1], &ipOctets[2], &ipOctets[3]);
+            if (scanned == 4)
             {
-                if (++index == strlen(expectedResponse))
+                for (int octet = 0; octet < 4; octet++)
                 {
-                    found = true;
+                    (*ip)[octet] = (uint8_t)ipOctets[octet];
                 }
             }
-            else
-            {
-                index = 0;
-            }
         }
     }
-    return found ? LTE_SHIELD_ERROR_SUCCESS : LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-LTE_Shield_error_t LTE_Shield::sendCommandWithResponse(
-    const char *command, const char *expectedResponse, char *responseDest,
-    unsigned long commandTimeout, boolean at)
+static LTE_Shield_error_t parseConfigRecord(char *record, void **results, int arg)
 {
-    unsigned long timeIn;
-    boolean found = false;
-    int index = 0;
-    int destIndex = 0;
-    unsigned int charsRead = 0;
+    uint8_t *current = (uint8_t *)results[0];
+    int a, b;
 
-    //Serial.print("Command: ");
-    //Serial.println(String(command));
-    sendCommand(command, at);
-    //Serial.print("Response: ");
-    timeIn = millis();
-    while ((!found) && (timeIn + commandTimeout > millis()))
+    // Each line of the AT+CMEE?;+UGPIOC?;+CMGF?;+CTZU?;+UDCONF=1 reply, flag the settings already in place
+    if (sscanf(record, " +CMEE: %d", &a) == 1)
     {
-        if (hwAvailable())
-        {
-            char c = readChar();
-            //Serial.write(c);
-            if (responseDest != NULL)
-            {
-                responseDest[destIndex++] = c;
-            }
-            charsRead++;
-            if (c == expectedResponse[index])
-            {
-                if (++index == strlen(expectedResponse))
-                {
-                    found = true;
-                }
-            }
-            else
-            {
-                index = 0;
-            }
-        }
+        if (a == 1)
+            *current |= LTE_SHIELD_CONFIG_CMEE;
     }
-    //Serial.println();
-
-    if (found)
+    else if (sscanf(record, " +CMGF: %d", &a) == 1)
     {
-        return LTE_SHIELD_ERROR_SUCCESS;
+        if (a == 1)
+            *current |= LTE_SHIELD_CONFIG_CMGF;
     }
-    else if (charsRead == 0)
+    else if (sscanf(record, " +CTZU: %d", &a) == 1)
     {
-        return LTE_SHIELD_ERROR_NO_RESPONSE;
+        if (a == 1)
+            *current |= LTE_SHIELD_CONFIG_CTZU;
     }
-    else
+    else if (sscanf(record, " +UDCONF: 1,%d", &a) == 1)
     {
-        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+        if (a == 1)
+            *current |= LTE_SHIELD_CONFIG_HEX;
+    }
+    else if (sscanf(record, " %d,%d", &a, &b) == 2) // +UGPIOC? lists "<gpio>,<mode>" per line
+    {
+        if ((a == LTE_Shield::GPIO1) && (b == LTE_Shield::NETWORK_STATUS))
+            *current |= LTE_SHIELD_CONFIG_GPIO1;
+        else if ((a == LTE_Shield::GPIO2) && (b == LTE_Shield::GNSS_SUPPLY_ENABLE))
+            *current |= LTE_SHIELD_CONFIG_GPIO2;
     }
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-boolean LTE_Shield::sendCommand(const char *command, boolean at)
+static LTE_Shield_error_t parseOperatorRecord(char *record, void **results, int maxOps)
 {
-    readAvailable(NULL); // Clear out receive buffer before sending a new command
+    struct operator_stats *opRet = (struct operator_stats *)results[0];
+    uint8_t *opsSeen = (uint8_t *)results[1];
+    char *opBegin;
+    int stat;
+    char longOp[26];
+    char shortOp[11];
+    int act;
+    unsigned long numOp;
+
+    // Sample responses, each record runs up to and including a ')':
+    // +COPS: (3,"Verizon Wireless","VzW","311480",8),,(0,1,2,3,4),(0,1,2)
+    // +COPS: (1,"313 100","313 100","313100",8),(2,"AT&T","AT&T","310410",8),(3,"311 480","311 480","311480",8),,(0,1,2,3,4),(0,1,2)
 
-    if (at)
-    {
-        hwPrint(LTE_SHIELD_COMMAND_AT);
-        hwPrint(command);
-        hwPrint("\r");
-    }
-    else
+    if (*opsSeen >= maxOps)
+        return LTE_SHIELD_ERROR_SUCCESS; // No room for any more
+
+    opBegin = strchr(record, '(');
+    if (opBegin == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    // The trailing supported-mode lists, e.g. (0,1,2,3,4), won't match this pattern
+    if (sscanf(opBegin, "(%d,\"%25[^\"]\",\"%10[^\"]\",\"%lu\",%d)",
+               &stat, longOp, shortOp, &numOp, &act) != 5)
     {
-        hwPrint(command);
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
     }
 
-    return true;
+    opRet[*opsSeen].stat = stat;
+    opRet[*opsSeen].longOp = (String)(longOp);
+    opRet[*opsSeen].shortOp = (String)(shortOp);
+    opRet[*opsSeen].numOp = numOp;
+    opRet[*opsSeen].act = act;
+    *opsSeen += 1;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-LTE_Shield_error_t LTE_Shield::parseSocketReadIndication(int socket, int length)
+static LTE_Shield_error_t parseOperatorResponse(char *response, void **results, int arg)
 {
-    LTE_Shield_error_t err;
-    char *readDest;
-
-    if ((socket < 0) || (length < 0))
-    {
-        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
-    }
+    String *oper = (String *)results[0];
+    char *searchPtr;
+    char mode;
 
-    readDest = lte_calloc_char(length + 1);
-    if (readDest == NULL)
-        return LTE_SHIELD_ERROR_OUT_OF_MEMORY;
+    searchPtr = strstr(response, "+COPS: ");
+    if (searchPtr == NULL)
+        return LTE_SHIELD_ERROR_SUCCESS;
 
-    err = socketRead(socket, length, readDest);
-    if (err != LTE_SHIELD_ERROR_SUCCESS)
+    searchPtr += strlen("+COPS: "); //  Move searchPtr to first char
+    mode = *searchPtr;              // Read first char -- should be mode
+    if (mode == '2')                // Check for de-register
     {
-        free(readDest);
-        return err;
+        return LTE_SHIELD_ERROR_DEREGISTERED;
     }
-
-    if (_socketReadCallback != NULL)
+    // Otherwise if it's default, manual, set-only, or automatic
+    else if ((mode == '0') || (mode == '1') || (mode == '3') || (mode == '4'))
     {
-        _socketReadCallback(socket, String(readDest));
+        *oper = "";
+        searchPtr = strchr(searchPtr, '\"'); // Move to first quote
+        if (searchPtr == NULL)
+        {
+            return LTE_SHIELD_ERROR_DEREGISTERED;
+        }
+        while ((*(++searchPtr) != '\"') && (*searchPtr != '\0'))
+        {
+            oper->concat(*(searchPtr));
+        }
     }
-
-    free(readDest);
     return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-LTE_Shield_error_t LTE_Shield::parseSocketListenIndication(IPAddress localIP, IPAddress remoteIP)
+static LTE_Shield_error_t parseGpioModeResponse(char *response, void **results, int gpio)
 {
-    _lastLocalIP = localIP;
-    _lastRemoteIP = remoteIP;
+    char gpioChar[4];
+    char *gpioStart;
+    int gpioMode;
+
+    sprintf(gpioChar, "%d", gpio);          // Convert GPIO to char array
+    gpioStart = strstr(response, gpioChar); // Find first occurence of GPIO in response
+    if (gpioStart == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    if (sscanf(gpioStart, "%*d,%d\r\n", &gpioMode) != 1)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    *((LTE_Shield::LTE_Shield_gpio_mode_t *)results[0]) = (LTE_Shield::LTE_Shield_gpio_mode_t)gpioMode;
     return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-LTE_Shield_error_t LTE_Shield::parseSocketCloseIndication(String *closeIndication)
+static LTE_Shield_error_t parseSocketOpenResponse(char *response, void **results, int arg)
 {
-    LTE_Shield_error_t err;
-    int search;
+    char *responseStart;
     int socket;
 
-    search = closeIndication->indexOf("UUSOCL: ") + strlen("UUSOCL: ");
-
-    // Socket will be first integer, should be single-digit number between 0-6:
-    socket = closeIndication->substring(search, search + 1).toInt();
+    responseStart = strstr(response, "+USOCR");
+    if (responseStart == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    if (sscanf(responseStart, "+USOCR: %d", (int *)results[0]) != 1)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
 
-    if (_socketCloseCallback != NULL)
+    // A socket number freed by +UUSOCL can come straight back, forget its old state
+    socket = *((int *)results[0]);
+    if ((socket >= 0) && (socket < LTE_SHIELD_NUM_SOCKETS))
     {
-        _socketCloseCallback(socket);
+        ((uint8_t *)results[1])[socket] = 0;
+        ((unsigned int *)results[2])[socket] = 0;
     }
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
 
+static LTE_Shield_error_t parseSocketConnectStartResponse(char *response, void **results, int arg)
+{
+    // Only an OK, the connect time is counted from here
+    *((uint8_t *)results[0]) |= LTE_SHIELD_SOCKET_CONNECTING;
+    *((unsigned long *)results[1]) = millis();
     return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-size_t LTE_Shield::hwPrint(const char *s)
+static LTE_Shield_error_t parseSocketWriteResponse(char *response, void **results, int arg)
 {
-    if (_hardSerial != NULL)
-    {
-        return _hardSerial->print(s);
-    }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
-    {
-        return _softSerial->print(s);
-    }
-#endif
+    char *responseStart;
+    unsigned long written;
 
-    return (size_t)0;
+    // Example: +USOWR: 0,1024 or +USOST: 0,1024
+    responseStart = strstr(response, "+USOWR");
+    if (responseStart == NULL)
+        responseStart = strstr(response, "+USOST");
+    if (responseStart == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    if (sscanf(responseStart + strlen("+USOWR"), ": %*d,%lu", &written) != 1)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    *((size_t *)results[0]) = written;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-size_t LTE_Shield::hwWrite(const char c)
+static LTE_Shield_error_t parseSocketReadResponse(char *response, void **results, int arg)
 {
-    if (_hardSerial != NULL)
-    {
-        return _hardSerial->write(c);
-    }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
-    {
-        return _softSerial->write(c);
-    }
-#endif
-
-    return (size_t)0;
+    char *responseStart;
+    unsigned int *unread = (unsigned int *)results[1];
+    unsigned int length;
+
+    // Example: +USORD: 0,5,"hello" -- the data itself went to the read buffer
+    responseStart = strstr(response, "+USORD");
+    if ((responseStart == NULL) || (sscanf(responseStart, "+USORD: %*d,%u", &length) != 1))
+        return LTE_SHIELD_ERROR_SUCCESS; // Nothing was read
+    *unread = (length < *unread) ? *unread - length : 0;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-int LTE_Shield::readAvailable(char *inString)
+static LTE_Shield_error_t parseSocketRecvFromResponse(char *response, void **results, int arg)
 {
-    int len = 0;
+    char *responseStart;
+    unsigned int *unread = (unsigned int *)results[1];
+    int ip[4];
+    unsigned int port, length;
 
-    if (_hardSerial != NULL)
+    // Example: +USORF: 0,"192.168.0.1",16666,5,"hello" -- the data itself went to the read buffer
+    responseStart = strstr(response, "+USORF");
+    if ((responseStart == NULL) ||
+        (sscanf(responseStart, "+USORF: %*d,\"%d.%d.%d.%d\",%u,%u",
+                &ip[0], &ip[1], &ip[2], &ip[3], &port, &length) != 6))
+        return LTE_SHIELD_ERROR_SUCCESS; // Nothing was read
+
+    if (unread != NULL)
     {
-        while (_hardSerial->available())
-        {
-            char c = (char)_hardSerial->read();
-            if (inString != NULL)
-            {
-                inString[len++] = c;
-            }
-        }
-        if (inString != NULL)
-        {
-            inString[len] = 0;
-        }
+        *unread = 0; // Read or not, the rest of the datagram is gone, the next one gets its own +UUSORF
     }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    if (_softSerial != NULL)
+    if (results[2] != NULL)
     {
-        while (_softSerial->available())
-        {
-            char c = (char)_softSerial->read();
-            if (inString != NULL)
-            {
-                inString[len++] = c;
-            }
-        }
-        if (inString != NULL)
+        for (int octet = 0; octet < 4; octet++)
         {
-            inString[len] = 0;
+            (*((IPAddress *)results[2]))[octet] = (uint8_t)ip[octet];
         }
     }
-#endif
+    if (results[3] != NULL)
+    {
+        *((unsigned int *)results[3]) = port;
+    }
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
 
-    return len;
+static LTE_Shield_error_t parseGpsOnResponse(char *response, void **results, int arg)
+{
+    // Example response: "+UGPS: 0" for off "+UGPS: 1,0,1" for on
+    // May be too lazy/simple, but just search for a '1'
+    *((boolean *)results[0]) = (strchr(response, '1') != NULL);
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-char LTE_Shield::readChar(void)
+static LTE_Shield_error_t parseRmcResponse(char *response, void **results, int arg)
 {
-    char ret;
+    char *rmcBegin;
 
-    if (_hardSerial != NULL)
-    {
-        ret = (char)_hardSerial->read();
-    }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
-    {
-        ret = (char)_softSerial->read();
-    }
-#endif
+    // Fast-forward response string to $GPRMC starter
+    rmcBegin = strstr(response, "$GPRMC");
+    if (rmcBegin == NULL)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
 
-    return ret;
+    *((boolean *)results[3]) = parseGPRMCString(rmcBegin, (PositionData *)results[0],
+                                                (ClockData *)results[2], (SpeedData *)results[1]);
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-int LTE_Shield::hwAvailable(void)
+static LTE_Shield_error_t parsePsmResponse(char *response, void **results, int arg)
 {
-    if (_hardSerial != NULL)
+    struct PsmSettings *psm = (struct PsmSettings *)results[0];
+    char *searchPtr;
+    char *timers[4];
+    int numTimers = 0;
+    int mode;
+
+    // Example: +UCPSMS: 1,,,"01000011","00000101" -- periodic TAU and active time are the last two
+    searchPtr = strstr(response, "+UCPSMS: ");
+    if ((searchPtr == NULL) || (sscanf(searchPtr, "+UCPSMS: %d", &mode) != 1))
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    while ((numTimers < 4) && ((searchPtr = strchr(searchPtr, '\"')) != NULL))
     {
-        return _hardSerial->available();
+        timers[numTimers++] = ++searchPtr;
+        searchPtr = strchr(searchPtr, '\"');
+        if (searchPtr == NULL)
+            return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+        *searchPtr++ = '\0';
     }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
+
+    psm->enabled = (mode == 1);
+    psm->periodicTau = 0;
+    psm->activeTime = 0;
+    if (numTimers >= 2)
     {
-        return _softSerial->available();
+        psm->periodicTau = decodePsmTimer(timers[numTimers - 2], LTE_SHIELD_PSM_TAU_UNITS, NUM_PSM_TAU_UNITS);
+        psm->activeTime = decodePsmTimer(timers[numTimers - 1], LTE_SHIELD_PSM_ACTIVE_UNITS, NUM_PSM_ACTIVE_UNITS);
     }
-#endif
-
-    return -1;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-void LTE_Shield::beginSerial(unsigned long baud)
+static LTE_Shield_error_t parseEdrxResponse(char *response, void **results, int arg)
 {
-    if (_hardSerial != NULL)
-    {
-        _hardSerial->begin(baud);
-    }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
+    struct EdrxSettings *edrx = (struct EdrxSettings *)results[0];
+    int act;
+    char requested[5], provided[5], window[5];
+
+    // Example: +CEDRXRDP: 4,"0010","0010","0011" -- just "+CEDRXRDP: 0" when eDRX isn't in use
+    edrx->enabled = false;
+    edrx->cycle = 0;
+    edrx->pagingWindow = 0;
+    if (sscanf(response, "\r\n+CEDRXRDP: %d", &act) != 1)
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+    if (sscanf(response, "\r\n+CEDRXRDP: %*d,\"%4[01]\",\"%4[01]\",\"%4[01]\"",
+               requested, provided, window) != 3)
     {
-        _softSerial->begin(baud);
+        return LTE_SHIELD_ERROR_SUCCESS;
     }
-#endif
-    delay(100);
+
+    edrx->enabled = (act != 0);
+    edrx->cycle = LTE_SHIELD_EDRX_CYCLES[strtol(provided, NULL, 2) & 0x0F];
+    edrx->pagingWindow = (strtol(window, NULL, 2) + 1) * LTE_SHIELD_EDRX_PTW_UNIT;
+    return LTE_SHIELD_ERROR_SUCCESS;
 }
 
-void LTE_Shield::setTimeout(unsigned long timeout)
+// Closest timer octet that's no shorter than seconds, as the 8 character bit string +CPSMS takes
+static void encodePsmTimer(unsigned long seconds, const unsigned long *units, int numUnits, char *bits)
 {
-    if (_hardSerial != NULL)
+    boolean found = false;
+    unsigned long best = 0;
+    int bestUnit = 0;
+    unsigned long bestValue = 0;
+    uint8_t octet;
+
+    for (int unit = 0; unit < numUnits; unit++)
     {
-        _hardSerial->setTimeout(timeout);
+        unsigned long value = (seconds + units[unit] - 1) / units[unit];
+        if ((value <= 31) && (!found || (value * units[unit] < best)))
+        {
+            found = true;
+            best = value * units[unit];
+            bestUnit = unit;
+            bestValue = value;
+        }
     }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
+    if (!found)
     {
-        _softSerial->setTimeout(timeout);
+        // Longer than the timer can go, use its maximum
+        for (int unit = 0; unit < numUnits; unit++)
+        {
+            if (units[unit] > units[bestUnit])
+                bestUnit = unit;
+        }
+        bestValue = 31;
     }
-#endif
+
+    octet = (bestUnit << 5) | bestValue;
+    for (int bit = 0; bit < 8; bit++)
+        bits[bit] = (octet & (0x80 >> bit)) ? '1' : '0';
+    bits[8] = '\0';
 }
 
-bool LTE_Shield::find(char *target)
+static unsigned long decodePsmTimer(const char *bits, const unsigned long *units, int numUnits)
 {
-    bool found = false;
-    if (_hardSerial != NULL)
-    {
-        found = _hardSerial->find(target);
-    }
-#ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
-    else if (_softSerial != NULL)
-    {
-        found = _softSerial->find(target);
-    }
-#endif
-    return found;
+    int octet = strtol(bits, NULL, 2);
+    int unit = (octet >> 5) & 0x07;
+
+    if (unit >= numUnits)
+        return 0; // Deactivated
+    return (octet & 0x1F) * units[unit];
 }
 
-LTE_Shield_error_t LTE_Shield::autobaud(unsigned long desiredBaud)
+static LTE_Shield_error_t parseResolveResponse(char *response, void **results, int arg)
 {
-    LTE_Shield_error_t err = LTE_SHIELD_ERROR_INVALID;
-    int b = 0;
+    char *responseStart;
+    int ip[4];
 
-    while ((err != LTE_SHIELD_ERROR_SUCCESS) && (b < NUM_SUPPORTED_BAUD))
-    {
-        beginSerial(LTE_SHIELD_SUPPORTED_BAUD[b++]);
-        setBaud(desiredBaud);
-        delay(200);
-        beginSerial(desiredBaud);
-        err = at();
-    }
-    if (err == LTE_SHIELD_ERROR_SUCCESS)
+    // Example: +UDNSRN: "93.184.216.34"
+    responseStart = strstr(response, "+UDNSRN");
+    if ((responseStart == NULL) ||
+        (sscanf(responseStart, "+UDNSRN: \"%d.%d.%d.%d\"", &ip[0], &ip[1], &ip[2], &ip[3]) != 4))
+        return LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE;
+
+    for (int octet = 0; octet < 4; octet++)
     {
-        beginSerial(desiredBaud);
+        ((uint8_t *)results[0])[octet] = (uint8_t)ip[octet];
     }
-    return err;
+    return LTE_SHIELD_ERROR_SUCCESS;
+}
+
+static boolean isIpAddress(const char *address)
+{
+    int ip[4];
+    int end = 0;
+
+    // Dotted quad and nothing else, e.g. "10.0.0.1" but not "10.example.com"
+    return (sscanf(address, "%d.%d.%d.%d%n", &ip[0], &ip[1], &ip[2], &ip[3], &end) == 4) &&
+           (address[end] == '\0');
 }
 
-char *LTE_Shield::lte_calloc_char(size_t num)
+static uint8_t hexNibble(char c)
 {
-    return (char *)calloc(num, sizeof(char));
+    // The module sends upper case, anything that isn't a digit decodes as 0
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return 0;
 }
 
 // GPS Helper Functions:
@@ -61,6 +61,87 @@
 #define LTE_SHIELD_POWER_PIN 5
 #define LTE_SHIELD_RESET_PIN 6
 
+#define LTE_SHIELD_NUM_SOCKETS 6
+
+// Asynchronous command engine sizing, trades RAM for queue depth. The library is compiled
+// separately from the sketch, so set these with build flags (-DLTE_SHIELD_MAX_PENDING_COMMANDS=4)
+// or by editing this header, never with a #define in the sketch: the two would disagree on the
+// size of LTE_Shield. The same goes for every other size below.
+#ifndef LTE_SHIELD_MAX_PENDING_COMMANDS
+#define LTE_SHIELD_MAX_PENDING_COMMANDS 3 // Commands that can be queued at once
+#endif
+#ifndef LTE_SHIELD_MAX_COMMAND_LENGTH
+#define LTE_SHIELD_MAX_COMMAND_LENGTH 64 // Longest command, excluding "AT", "\r" and one long string argument
+#endif
+#ifndef LTE_SHIELD_RESPONSE_BUFFER_SIZE
+#define LTE_SHIELD_RESPONSE_BUFFER_SIZE 128 // Shared by the active command
+#endif
+#define LTE_SHIELD_MAX_COMMAND_RESULTS 4 // Result pointers a command can fill in
+
+// Receive path sizing
+#ifndef LTE_SHIELD_RX_BUFFER_SIZE
+#define LTE_SHIELD_RX_BUFFER_SIZE 64 // Bytes poll() pulls from the UART per call
+#endif
+#ifndef LTE_SHIELD_RX_LINE_SIZE
+#define LTE_SHIELD_RX_LINE_SIZE 128 // Longest unsolicited line, e.g. +UULOC
+#endif
+#ifndef LTE_SHIELD_SOCKET_WRITE_MAX
+#define LTE_SHIELD_SOCKET_WRITE_MAX 1024 // Most the modem takes in one +USOWR, longer writes are split
+#endif
+#ifndef LTE_SHIELD_SOCKET_WRITE_MAX_HEX
+#define LTE_SHIELD_SOCKET_WRITE_MAX_HEX 512 // The same in hex data mode, where each byte is two digits
+#endif
+#ifndef LTE_SHIELD_SOCKET_READ_MAX
+#define LTE_SHIELD_SOCKET_READ_MAX 1024 // Most the modem returns from one +USORD
+#endif
+#ifndef LTE_SHIELD_SOCKET_READ_MAX_HEX
+#define LTE_SHIELD_SOCKET_READ_MAX_HEX 512 // The same in hex data mode
+#endif
+#ifndef LTE_SHIELD_SOCKET_READ_CHUNK
+#define LTE_SHIELD_SOCKET_READ_CHUNK 64 // Bytes per +USORD when handling a +UUSORD, lives on the stack
+#endif
+#ifndef LTE_SHIELD_DNS_CACHE_SIZE
+#define LTE_SHIELD_DNS_CACHE_SIZE 3 // Host names resolve() remembers, 0 leaves the cache out
+#endif
+#ifndef LTE_SHIELD_DNS_HOST_SIZE
+#define LTE_SHIELD_DNS_HOST_SIZE 32 // Longest cached host name, including the NUL
+#endif
+#ifndef LTE_SHIELD_URC_QUEUE_SIZE
+#define LTE_SHIELD_URC_QUEUE_SIZE 128 // Bytes of URC text held while commands are running
+#endif
+// Per-command latency statistics, off by default. Enable with -DLTE_SHIELD_ENABLE_COMMAND_STATS=1
+// (or by editing this line), the library is compiled separately from the sketch.
+#ifndef LTE_SHIELD_ENABLE_COMMAND_STATS
+#define LTE_SHIELD_ENABLE_COMMAND_STATS 0
+#endif
+#ifndef LTE_SHIELD_STATS_VERBS
+#define LTE_SHIELD_STATS_VERBS 12 // Distinct commands tracked, later ones aren't recorded
+#endif
+#define LTE_SHIELD_STATS_BUCKETS 16 // Bucket n counts latencies in [2^(n-1), 2^n) ms, the last is open-ended
+// Per-socket write buffers (setSocketWriteBuffer()), on by default. Build with
+// -DLTE_SHIELD_ENABLE_WRITE_BUFFER=0 to leave them and their bookkeeping out of LTE_Shield.
+#ifndef LTE_SHIELD_ENABLE_WRITE_BUFFER
+#define LTE_SHIELD_ENABLE_WRITE_BUFFER 1
+#endif
+// Serial trace recorder, off by default. Enable with -DLTE_SHIELD_ENABLE_TRACE=1 to keep every
+// byte sent to and received from the module, with its timestamp, for LTE_Shield_Replay.
+#ifndef LTE_SHIELD_ENABLE_TRACE
+#define LTE_SHIELD_ENABLE_TRACE 0
+#endif
+#ifndef LTE_SHIELD_TRACE_SIZE
+#define LTE_SHIELD_TRACE_SIZE 512 // Bytes of trace kept, the oldest records are dropped first
+#endif
+// Each trace record is a header byte, up to 5 delta extension bytes, then the byte itself.
+// The header's low 6 bits are the low bits of the microseconds since the previous record,
+// if bit 6 is set the rest follow 7 bits at a time, least significant first, with bit 7
+// set on all but the last. Header bit 7 marks bytes sent to the module.
+#define LTE_SHIELD_TRACE_TX 0x80
+#define LTE_SHIELD_TRACE_EXTENDED 0x40
+#define LTE_SHIELD_TRACE_DELTA_MASK 0x3F
+#ifndef LTE_SHIELD_MAX_URC_HANDLERS
+#define LTE_SHIELD_MAX_URC_HANDLERS 4 // User handlers registered with setUrcHandler()
+#endif
+
 typedef enum
 {
     MNO_INVALID = -1,
@@ -82,10 +163,79 @@ typedef enum
     LTE_SHIELD_ERROR_UNEXPECTED_PARAM,    // 3
     LTE_SHIELD_ERROR_UNEXPECTED_RESPONSE, // 4
     LTE_SHIELD_ERROR_NO_RESPONSE,         // 5
-    LTE_SHIELD_ERROR_DEREGISTERED         // 6
+    LTE_SHIELD_ERROR_DEREGISTERED,        // 6
+    LTE_SHIELD_ERROR_ERROR,               // 7 -- Modem answered "ERROR"
+    LTE_SHIELD_ERROR_CME_ERROR,           // 8 -- "+CME ERROR: <n>", see lastErrorCode()
+    LTE_SHIELD_ERROR_CMS_ERROR,           // 9 -- "+CMS ERROR: <n>", see lastErrorCode()
+    LTE_SHIELD_ERROR_NO_CARRIER,          // 10 -- "NO CARRIER", "BUSY", "NO ANSWER" or "NO DIALTONE"
+    LTE_SHIELD_ERROR_RESPONSE_OVERFLOW    // 11 -- Response didn't fit the capture buffer, kept what did
 } LTE_Shield_error_t;
 #define LTE_SHIELD_SUCCESS LTE_SHIELD_ERROR_SUCCESS
 
+struct InitStats
+{
+    uint8_t roundTrips;             // Commands sent to the modem by the last begin() or reset()
+    unsigned long duration;         // ms from the start of init to ready
+    uint8_t autobaudProbes;         // Baud rates tried because the modem didn't answer at the requested one
+    unsigned long autobaudDuration; // ms spent on those probes
+};
+
+// Steps recover() takes, in order, to bring the modem back
+typedef enum
+{
+    LTE_SHIELD_RECOVERY_FAILED = 0,  // Nothing worked, the modem is still not answering, or begin() hasn't run
+    LTE_SHIELD_RECOVERY_AT,          // It answered "AT", nothing needed doing
+    LTE_SHIELD_RECOVERY_HW_RESET,    // RESET_N pulse
+    LTE_SHIELD_RECOVERY_POWER_CYCLE  // PWR_ON pulses
+} LTE_Shield_recovery_tier_t;
+
+struct RecoveryResult
+{
+    LTE_Shield_recovery_tier_t tier; // Step that got the modem answering again
+    uint8_t pings;                   // "AT"s sent while waiting for it
+    unsigned long duration;          // ms from the start of recovery, including init()
+};
+
+struct DirectLinkStats
+{
+    unsigned long bytesSent;
+    unsigned long bytesReceived;
+    unsigned long duration; // ms from CONNECT to the start of the escape, or to now if still open
+    unsigned long rate;     // Bytes per second, both directions together
+};
+
+struct DnsCacheStats
+{
+    unsigned long hits;     // Answered from the cache
+    unsigned long misses;   // Looked up by the module
+    unsigned long failures; // Lookups that didn't find an address
+    uint8_t entries;        // Cached names still within the TTL
+};
+
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+struct SocketWriteStats
+{
+    unsigned long writes;       // socketWrite() calls taken into the buffer
+    unsigned long flushes;      // +USOWR batches they went out in
+    unsigned long bytes;        // Sent by those flushes
+    unsigned long averageBatch; // Bytes per flush
+};
+#endif
+
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+struct CommandStats
+{
+    char verb[8];                // e.g. "+CSQ", "E" for ATE0, "" for a plain AT
+    unsigned long count;         // Completed commands, including failures
+    unsigned long minLatency;    // ms from sending the command to its final result
+    unsigned long maxLatency;
+    unsigned long totalLatency;  // Divide by count for the mean
+    unsigned long timeouts;      // Gave up waiting on the modem
+    unsigned long errors;        // Any other failure (ERROR, +CME ERROR, bad response...)
+    uint16_t histogram[LTE_SHIELD_STATS_BUCKETS];
+};
+#endif
+
 typedef enum
 {
     LTE_SHIELD_REGISTRATION_INVALID = -1,
@@ -144,6 +294,30 @@ struct SpeedData
     char magVarDir;
 };
 
+// Power Saving Mode timers. Either may be 0 if the network turned that timer off.
+struct PsmSettings
+{
+    boolean enabled;
+    unsigned long periodicTau; // T3412, seconds between tracking area updates (wake-ups)
+    unsigned long activeTime;  // T3324, seconds the modem stays reachable after each wake-up
+};
+
+// Extended discontinuous reception, LTE Cat M1 cycle lengths
+struct EdrxSettings
+{
+    boolean enabled;
+    unsigned long cycle;        // ms between paging windows
+    unsigned long pagingWindow; // ms the modem listens each cycle
+};
+
+typedef enum
+{
+    LTE_SHIELD_UART_POWER_SAVING_DISABLED = 0,
+    LTE_SHIELD_UART_POWER_SAVING_TIMEOUT = 1, // Sleeps after the UART has been idle a while
+    LTE_SHIELD_UART_POWER_SAVING_RTS = 2,     // Sleeps while RTS is off
+    LTE_SHIELD_UART_POWER_SAVING_DTR = 3      // Sleeps while DTR is off
+} lte_shield_uart_power_saving_t;
+
 struct operator_stats
 {
     uint8_t stat;
@@ -159,12 +333,35 @@ typedef enum
     LTE_SHIELD_UDP = 17
 } lte_shield_socket_protocol_t;
 
+typedef enum
+{
+    LTE_SHIELD_DATA_MODE_TEXT = 0, // Socket data goes over the UART as-is
+    LTE_SHIELD_DATA_MODE_HEX = 1   // Two hex digits per byte (AT+UDCONF=1,1)
+} lte_shield_data_mode_t;
+
 typedef enum
 {
     LTE_SHIELD_MESSAGE_FORMAT_PDU = 0,
     LTE_SHIELD_MESSAGE_FORMAT_TEXT = 1
 } lte_shield_message_format_t;
 
+typedef enum
+{
+    LTE_SHIELD_COMMAND_STATUS_UNKNOWN = -1, // Handle isn't (or is no longer) tracked
+    LTE_SHIELD_COMMAND_STATUS_QUEUED = 0,   // Waiting for the modem to finish earlier commands
+    LTE_SHIELD_COMMAND_STATUS_ACTIVE,       // Sent, waiting on the modem's response
+    LTE_SHIELD_COMMAND_STATUS_COMPLETE      // Finished -- commandResult() is valid
+} LTE_Shield_command_status_t;
+
+// Called from poll() (or any blocking call) when an asynchronous command finishes.
+// Any results requested by the command have been written before this is called.
+typedef void (*LTE_Shield_command_callback_t)(int handle, LTE_Shield_error_t result);
+
+// Somewhere to keep the modem's baud rate between restarts, see setBaudStore().
+// The load function returns 0 if nothing has been saved yet.
+typedef unsigned long (*LTE_Shield_baud_load_t)(void);
+typedef void (*LTE_Shield_baud_save_t)(unsigned long baud);
+
 class LTE_Shield : public Print
 {
 public:
@@ -176,13 +373,87 @@ public:
     boolean begin(SoftwareSerial &softSerial, unsigned long baud = 9600);
 #endif
     boolean begin(HardwareSerial &hardSerial, unsigned long baud = 9600);
+    // Any other Stream (USB CDC, a test double...) must already be running at baud,
+    // the library won't try to change its rate
+    boolean begin(Stream &stream, unsigned long baud = 9600);
 
     // Loop polling and polling setup
     boolean poll(void);
     void setSocketReadCallback(void (*socketReadCallback)(int, String));
+    // Received data as raw bytes, NULs and all, in spans of up to LTE_SHIELD_SOCKET_READ_CHUNK.
+    // data points into the library's read buffer and is only valid during the call.
+    void setSocketDataCallback(void (*socketDataCallback)(int socket, const uint8_t *data, size_t length));
     void setSocketCloseCallback(void (*socketCloseCallback)(int));
+    // UDP datagrams announced by +UUSORF, with where they came from. The data callback is also called if set.
+    void setSocketRecvFromCallback(void (*socketRecvFromCallback)(int socket, const uint8_t *data, size_t length,
+                                                                  IPAddress remoteIP, unsigned int remotePort));
+    // Each datagram is read with a single +USORF, as SARA-R4 drops whatever a read leaves of one. They're read
+    // into buffer, which holds size - 1 bytes, or without one into LTE_SHIELD_SOCKET_READ_CHUNK bytes on the
+    // stack. Longer datagrams are cut short, so size it for the largest expected.
+    void setSocketRecvFromBuffer(uint8_t *buffer, size_t size);
+    // Outcome of a socketConnectStart(): error is 0 once connected, otherwise the module's socket error.
+    // elapsed is the time in ms since the module took the request.
+    void setSocketConnectCallback(void (*socketConnectCallback)(int socket, int error, unsigned long elapsed));
     void setGpsReadCallback(void (*gpsRequestCallback)(ClockData time,
                                                        PositionData gps, SpeedData spd, unsigned long uncertainty));
+    // Called with true as the modem enters Power Saving Mode, false once it has woken
+    void setSleepCallback(void (*sleepCallback)(boolean asleep));
+    // Handle any other URC, e.g. "+CMTI". The handler gets everything after "+CMTI: ".
+    // prefix must stay valid while registered. Pass a NULL handler to remove one.
+    boolean setUrcHandler(const char *prefix, void (*urcHandler)(const char *params));
+    // URCs that arrive while a command is running are held and handled by the next poll().
+    // This counts the ones lost because the queue was full.
+    unsigned long droppedUrcs(void);
+
+    // Asynchronous commands
+    // Every *Async() method queues its command and returns straight away with
+    // a handle (>= 0), or a negated LTE_Shield_error_t if it couldn't be queued.
+    // Commands are sent one at a time and driven by poll(). Result pointers
+    // (and any payload strings) must stay valid until the command completes.
+    // So must host names, APNs and numbers too long to copy into the command
+    // (LTE_SHIELD_MAX_COMMAND_LENGTH), which are sent from the caller's string.
+    // A command whose response is parsed fails with LTE_SHIELD_ERROR_RESPONSE_OVERFLOW if the
+    // response didn't fit LTE_SHIELD_RESPONSE_BUFFER_SIZE, rather than parsing what did. Lists
+    // parsed an entry at a time (getOperators()) keep the entries that fit.
+    LTE_Shield_command_status_t commandStatus(int handle);
+    LTE_Shield_error_t commandResult(int handle);
+    LTE_Shield_error_t waitForCommand(int handle);
+    uint8_t pendingCommands(void);
+    // Code from the last +CME ERROR or +CMS ERROR, valid when a command (or its callback)
+    // reports LTE_SHIELD_ERROR_CME_ERROR or LTE_SHIELD_ERROR_CMS_ERROR
+    int lastErrorCode(void);
+
+    // Cold-start cost of the last begin() or reset()
+    struct InitStats initStats(void);
+
+    // Remember the last baud rate the modem answered at, so the next begin() tries it first
+    // if the modem doesn't answer at the requested rate. Set before begin().
+    void setBaudStore(LTE_Shield_baud_load_t load, LTE_Shield_baud_save_t save);
+#ifdef ARDUINO_ARCH_AVR
+    // Keep it in 4 bytes of EEPROM starting at address, only written when it changes
+    void setBaudStoreEeprom(int address);
+#endif
+
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+    // Latency of every command sent, grouped by verb. Returns the table and its length.
+    const struct CommandStats *commandStats(uint8_t *verbs);
+    void resetCommandStats(void);
+    // One line per verb: "+CSQ n=12 min=20 avg=35 max=80 to=0 err=1 h=0,0,0,0,0,3,9"
+    void printCommandStats(Print &out);
+#endif
+
+#if LTE_SHIELD_ENABLE_TRACE
+    // Record the conversation with the module, recording starts off
+    void traceEnable(boolean enable = true);
+    void traceClear(void);
+    size_t traceLength(void);
+    // Copy the trace out, oldest record first. Returns the number of bytes copied,
+    // only whole records are copied.
+    size_t traceCopy(uint8_t *dest, size_t size);
+    // Hex dump of the trace, 32 bytes per line after a '#' line. On a host it turns back
+    // into a binary trace with: grep -v '^#' trace.txt | xxd -r -p > trace.bin
+    void traceDump(Print &out);
+#endif
 
     // Direct write/print to cell serial port
     virtual size_t write(uint8_t c);
@@ -191,24 +462,43 @@ public:
 
     // General AT Commands
     LTE_Shield_error_t at(void);
+    int atAsync(LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t enableEcho(boolean enable = true);
+    int enableEchoAsync(boolean enable = true, LTE_Shield_command_callback_t callback = NULL);
+    // Report failures as "+CME ERROR: <n>" rather than a bare "ERROR", enabled by begin()
+    LTE_Shield_error_t enableErrorCodes(boolean enable = true);
+    int enableErrorCodesAsync(boolean enable = true, LTE_Shield_command_callback_t callback = NULL);
     String imei(void);
+    int imeiAsync(String *imei, LTE_Shield_command_callback_t callback = NULL);
     String imsi(void);
+    int imsiAsync(String *imsi, LTE_Shield_command_callback_t callback = NULL);
     String ccid(void);
+    int ccidAsync(String *ccid, LTE_Shield_command_callback_t callback = NULL);
 
     // Control and status AT commands
     LTE_Shield_error_t reset(void);
+    // Get an unresponsive modem back: ping it, then escalate through a hardware reset
+    // and a power cycle, each given a few seconds to come back. Settings made by begin()
+    // are restored. Blocks for over a minute if nothing works. Fails straight away before begin().
+    struct RecoveryResult recover(void);
     String clock(void);
+    int clockAsync(String *clock, LTE_Shield_command_callback_t callback = NULL);
     // TODO: Return a clock struct
     LTE_Shield_error_t clock(uint8_t *y, uint8_t *mo, uint8_t *d,
                              uint8_t *h, uint8_t *min, uint8_t *s, uint8_t *tz);
+    int clockAsync(struct ClockData *clk, LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t autoTimeZone(boolean enable);
+    int autoTimeZoneAsync(boolean enable, LTE_Shield_command_callback_t callback = NULL);
 
     // Network service AT commands
     int8_t rssi(void);
+    int rssiAsync(int8_t *rssi, LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_registration_status_t registration(void);
+    int registrationAsync(LTE_Shield_registration_status_t *status,
+                          LTE_Shield_command_callback_t callback = NULL);
     boolean setNetwork(mobile_network_operator_t mno);
     mobile_network_operator_t getNetwork(void);
+    int getNetworkAsync(mobile_network_operator_t *mno, LTE_Shield_command_callback_t callback = NULL);
     typedef enum
     {
         PDP_TYPE_INVALID = -1,
@@ -217,8 +507,12 @@ public:
         PDP_TYPE_IPV4V6 = 2,
         PDP_TYPE_IPV6 = 3
     } LTE_Shield_pdp_type;
+    // apn can be as long as the module takes, one too long for LTE_SHIELD_MAX_COMMAND_LENGTH is sent from apn
     LTE_Shield_error_t setAPN(String apn, uint8_t cid = 1, LTE_Shield_pdp_type pdpType = PDP_TYPE_IP);
+    int setAPNAsync(const char *apn, uint8_t cid = 1, LTE_Shield_pdp_type pdpType = PDP_TYPE_IP,
+                    LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t getAPN(String *apn, IPAddress *ip);
+    int getAPNAsync(String *apn, IPAddress *ip, LTE_Shield_command_callback_t callback = NULL);
 
     typedef enum
     {
@@ -230,18 +524,31 @@ public:
     } LTE_Shield_l2p_t;
     LTE_Shield_error_t enterPPP(uint8_t cid = 1, char dialing_type_char = 0,
                                 unsigned long dialNumber = 99, LTE_Shield_l2p_t l2p = L2P_DEFAULT);
+    int enterPPPAsync(uint8_t cid = 1, char dialing_type_char = 0,
+                      unsigned long dialNumber = 99, LTE_Shield_l2p_t l2p = L2P_DEFAULT,
+                      LTE_Shield_command_callback_t callback = NULL);
 
     uint8_t getOperators(struct operator_stats *op, int maxOps = 3);
+    int getOperatorsAsync(struct operator_stats *op, uint8_t *opsSeen, int maxOps = 3,
+                          LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t registerOperator(struct operator_stats oper);
+    int registerOperatorAsync(struct operator_stats oper, LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t getOperator(String *oper);
+    int getOperatorAsync(String *oper, LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t deregisterOperator(void);
+    int deregisterOperatorAsync(LTE_Shield_command_callback_t callback = NULL);
 
     // SMS -- Short Messages Service
     LTE_Shield_error_t setSMSMessageFormat(lte_shield_message_format_t textMode = LTE_SHIELD_MESSAGE_FORMAT_TEXT);
+    int setSMSMessageFormatAsync(lte_shield_message_format_t textMode = LTE_SHIELD_MESSAGE_FORMAT_TEXT,
+                                 LTE_Shield_command_callback_t callback = NULL);
+    // number, like message, isn't limited by LTE_SHIELD_MAX_COMMAND_LENGTH
     LTE_Shield_error_t sendSMS(String number, String message);
+    int sendSMSAsync(const char *number, const char *message, LTE_Shield_command_callback_t callback = NULL);
 
     // V24 Control and V25ter (UART interface) AT commands
     LTE_Shield_error_t setBaud(unsigned long baud);
+    int setBaudAsync(unsigned long baud, LTE_Shield_command_callback_t callback = NULL);
 
     // GPIO
     // GPIO pin map
@@ -279,17 +586,148 @@ public:
         PAD_DISABLED = 255
     } LTE_Shield_gpio_mode_t;
     LTE_Shield_error_t setGpioMode(LTE_Shield_gpio_t gpio, LTE_Shield_gpio_mode_t mode);
+    int setGpioModeAsync(LTE_Shield_gpio_t gpio, LTE_Shield_gpio_mode_t mode,
+                         LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_gpio_mode_t getGpioMode(LTE_Shield_gpio_t gpio);
+    int getGpioModeAsync(LTE_Shield_gpio_t gpio, LTE_Shield_gpio_mode_t *mode,
+                         LTE_Shield_command_callback_t callback = NULL);
 
     // IP Transport Layer
     int socketOpen(lte_shield_socket_protocol_t protocol, unsigned int localPort = 0);
+    int socketOpenAsync(lte_shield_socket_protocol_t protocol, int *socket, unsigned int localPort = 0,
+                        LTE_Shield_command_callback_t callback = NULL);
+    // Flushes a socket's write buffer first. The socket is closed even if that fails, and the flush's
+    // error is returned, the data it couldn't send is lost. socketCloseAsync() doesn't flush, and
+    // refuses with LTE_SHIELD_ERROR_UNEXPECTED_PARAM while the buffer still holds data.
     LTE_Shield_error_t socketClose(int socket, int timeout = 1000);
+    int socketCloseAsync(int socket, int timeout = 1000, LTE_Shield_command_callback_t callback = NULL);
+    // address is an IP or a host name of any length the module takes (up to 254 characters). Names
+    // too long for LTE_SHIELD_MAX_COMMAND_LENGTH are sent from address, so the Async variants need it
+    // kept valid until they complete. The same goes for socketConnectStart(), resolve() and socketSendTo().
     LTE_Shield_error_t socketConnect(int socket, const char *address, unsigned int port);
+    int socketConnectAsync(int socket, const char *address, unsigned int port,
+                           LTE_Shield_command_callback_t callback = NULL);
+    // Connect in the background (+USOCO async mode). Returns as soon as the module takes the
+    // request, the result arrives as +UUSOCO through poll(). Several sockets can be connecting
+    // at once, and other commands run meanwhile.
+    LTE_Shield_error_t socketConnectStart(int socket, const char *address, unsigned int port);
+    int socketConnectStartAsync(int socket, const char *address, unsigned int port,
+                                LTE_Shield_command_callback_t callback = NULL);
+    // A socketConnectStart() is still waiting on its +UUSOCO
+    boolean socketConnecting(int socket);
+    // Look up a host name with AT+UDNSRN. Answers are cached for the TTL, the module doesn't
+    // report the record's own. socketConnect() resolves host names through the cache and returns
+    // resolve()'s error if that fails, the Async connects use a cached address if there is one and
+    // pass the name on to the module if not.
+    LTE_Shield_error_t resolve(const char *host, IPAddress *ip);
+    // 0 turns caching off, connects then pass host names straight on to the module. The default is 5 minutes,
+    // caching is always off if the library is built with LTE_SHIELD_DNS_CACHE_SIZE 0.
+    void setDnsCacheTtl(unsigned long ttl);
+    void clearDnsCache(void);
+    struct DnsCacheStats dnsCacheStats(void);
+    // Resolves each host into the cache, so the first connects find them there. Call it once
+    // registration() reports the module registered, lookups fail before then. A host that
+    // fails doesn't stop the rest. Returns how many were resolved, none with caching off.
+    int prewarmDnsCache(const char *const *hosts, uint8_t count);
     LTE_Shield_error_t socketWrite(int socket, const char *str);
     LTE_Shield_error_t socketWrite(int socket, String str);
-    LTE_Shield_error_t socketRead(int socket, int length, char *readDest);
+    // Binary data, split into LTE_SHIELD_SOCKET_WRITE_MAX byte writes that are queued back to back.
+    // Returns the number of bytes the modem accepted, or a negated LTE_Shield_error_t if none were.
+    int socketWrite(int socket, const uint8_t *data, size_t length);
+    int socketWriteAsync(int socket, const char *str, LTE_Shield_command_callback_t callback = NULL);
+    // A single write of up to LTE_SHIELD_SOCKET_WRITE_MAX bytes, written is set to what the modem accepted
+    int socketWriteAsync(int socket, const uint8_t *data, size_t length, size_t *written = NULL,
+                         LTE_Shield_command_callback_t callback = NULL);
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    // Optional transmit buffer for a socket, in memory the sketch provides. socketWrite() then collects
+    // data there and sends it as one +USOWR once threshold bytes are waiting (0 for a full buffer), once
+    // the oldest has waited maxLatency ms, or on socketFlush(). poll() queues the write for a buffer that's
+    // due without waiting on it, and backs off before trying again if it fails. socketClose() flushes
+    // and detaches the buffer, a NULL buffer does the same without closing. socketWriteAsync() isn't
+    // buffered, flush before mixing the two.
+    LTE_Shield_error_t setSocketWriteBuffer(int socket, uint8_t *buffer, size_t size, size_t threshold = 0,
+                                            unsigned long maxLatency = 100);
+    LTE_Shield_error_t socketFlush(int socket);
+    // Totals since the buffer was set
+    struct SocketWriteStats socketWriteStats(int socket);
+#endif
+    // readLength, if given, is set to the number of bytes the modem returned
+    LTE_Shield_error_t socketRead(int socket, int length, char *readDest, int *readLength = NULL);
+    int socketReadAsync(int socket, int length, char *readDest, LTE_Shield_command_callback_t callback = NULL);
+    // Drains a socket with successive +USORDs of up to chunkSize bytes (capped at LTE_SHIELD_SOCKET_READ_MAX)
+    // into buffer, handing each chunk to consumer as it arrives, so RAM use is bounded by the chunk and
+    // not the amount waiting. Reads what +UUSORD announced and is still unread, otherwise stops when a
+    // read comes back short. Returns the total read, or a negated
+    // LTE_Shield_error_t if nothing could be.
+    int socketReadAll(int socket, char *buffer, size_t chunkSize,
+                      void (*consumer)(int socket, const uint8_t *data, size_t length));
+    // UDP: each send is one datagram of up to LTE_SHIELD_SOCKET_WRITE_MAX bytes to address (an IP) and port.
+    // Returns the number of bytes the modem accepted, or a negated LTE_Shield_error_t.
+    int socketSendTo(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length);
+    int socketSendToAsync(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length,
+                          size_t *written = NULL, LTE_Shield_command_callback_t callback = NULL);
+    // Splits data into datagrams of datagramLength bytes and queues them back to back, each going out
+    // as soon as the last is accepted. Returns the bytes accepted before any failure, like socketWrite().
+    int socketSendToBurst(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length,
+                          size_t datagramLength);
+    // One datagram, or up to length bytes of it, SARA-R4 drops the rest. remoteIP and remotePort, if given,
+    // are set to its source.
+    LTE_Shield_error_t socketRecvFrom(int socket, int length, char *readDest, int *readLength = NULL,
+                                      IPAddress *remoteIP = NULL, unsigned int *remotePort = NULL);
+    int socketRecvFromAsync(int socket, int length, char *readDest, int *readLength = NULL,
+                            IPAddress *remoteIP = NULL, unsigned int *remotePort = NULL,
+                            LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t socketListen(int socket, unsigned int port);
+    int socketListenAsync(int socket, unsigned int port, LTE_Shield_command_callback_t callback = NULL);
     IPAddress lastRemoteIP(void);
+    // Deferred sockets aren't read when +UUSORD arrives, the read callbacks aren't called.
+    // socketAvailable() says how much is waiting and socketRead() fetches it when wanted.
+    void deferSocketRead(int socket, boolean defer);
+    // On other sockets it's whatever the read on +UUSORD couldn't fetch, every command slot taken say
+    int socketAvailable(int socket);
+    // The modem has closed the socket (+UUSOCL) since it was opened
+    boolean socketClosed(int socket);
+    // How socketWrite() and socketRead() move data. Hex mode doubles the bytes on the UART but
+    // writes go out on the command line with no '@' prompt round trip. The module is switched
+    // over as needed before the next transfer, reads always decode back to bytes.
+    void setSocketDataMode(lte_shield_data_mode_t mode);
+    lte_shield_data_mode_t socketDataMode(void);
+    // Direct link (AT+USODL): the UART becomes a raw pipe to a connected socket, with no
+    // AT framing or round trips. Other commands and poll() are refused until directLinkEnd(),
+    // which escapes with a guard time either side of "+++". Data still arriving during the
+    // escape is dropped.
+    LTE_Shield_error_t directLinkBegin(int socket);
+    size_t directLinkWrite(const uint8_t *data, size_t length);
+    int directLinkAvailable(void);
+    // Returns the bytes read, 0 if nothing is waiting
+    int directLinkRead(uint8_t *buf, size_t length);
+    LTE_Shield_error_t directLinkEnd(void);
+    boolean directLinkActive(void);
+    // Totals for the current, or last, direct link session
+    struct DirectLinkStats directLinkStats(void);
+
+    // Power saving
+    // Ask for PSM with the given timers, in seconds. The network may grant something else,
+    // see psm(). Also turns on the +UUPSMR sleep/wake indications.
+    LTE_Shield_error_t setPsm(boolean enable, unsigned long periodicTau = 3600, unsigned long activeTime = 60);
+    int setPsmAsync(boolean enable, unsigned long periodicTau = 3600, unsigned long activeTime = 60,
+                    LTE_Shield_command_callback_t callback = NULL);
+    // The timers the network granted
+    LTE_Shield_error_t psm(struct PsmSettings *granted);
+    int psmAsync(struct PsmSettings *granted, LTE_Shield_command_callback_t callback = NULL);
+    // Ask for an eDRX cycle, in ms, rounded up to the next Cat M1 value (5120 ms to 10485760 ms)
+    LTE_Shield_error_t setEdrx(boolean enable, unsigned long cycle = 20480);
+    int setEdrxAsync(boolean enable, unsigned long cycle = 20480, LTE_Shield_command_callback_t callback = NULL);
+    // The cycle and paging window the network granted
+    LTE_Shield_error_t edrx(struct EdrxSettings *granted);
+    int edrxAsync(struct EdrxSettings *granted, LTE_Shield_command_callback_t callback = NULL);
+    // UART power saving (+UPSV), lets the modem sleep between network activity
+    LTE_Shield_error_t setUartPowerSaving(lte_shield_uart_power_saving_t mode);
+    int setUartPowerSavingAsync(lte_shield_uart_power_saving_t mode, LTE_Shield_command_callback_t callback = NULL);
+    // While the modem is in PSM commands are held in the queue. Blocking calls wake it,
+    // asynchronous ones wait for it to wake on its own or for wake().
+    boolean asleep(void);
+    void wake(void);
 
     // GPS
     typedef enum
@@ -303,8 +741,12 @@ public:
         GNSS_SYSTEM_GLONASS = 64
     } gnss_system_t;
     boolean gpsOn(void);
+    int gpsOnAsync(boolean *on, LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t gpsPower(boolean enable = true,
                                 gnss_system_t gnss_sys = GNSS_SYSTEM_GPS);
+    // Unlike gpsPower(), doesn't check the current GPS state first
+    int gpsPowerAsync(boolean enable = true, gnss_system_t gnss_sys = GNSS_SYSTEM_GPS,
+                      LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t gpsEnableClock(boolean enable = true);
     LTE_Shield_error_t gpsGetClock(struct ClockData *clock);
     LTE_Shield_error_t gpsEnableFix(boolean enable = true);
@@ -316,18 +758,27 @@ public:
     LTE_Shield_error_t gpsEnableSat(boolean enable = true);
     LTE_Shield_error_t gpsGetSat(uint8_t *sats);
     LTE_Shield_error_t gpsEnableRmc(boolean enable = true);
+    // Unlike gpsEnableRmc(), doesn't power the GPS on -- call gpsPowerAsync() first
+    int gpsEnableRmcAsync(boolean enable = true, LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t gpsGetRmc(struct PositionData *pos, struct SpeedData *speed,
                                  struct ClockData *clk, boolean *valid);
+    int gpsGetRmcAsync(struct PositionData *pos, struct SpeedData *speed,
+                       struct ClockData *clk, boolean *valid,
+                       LTE_Shield_command_callback_t callback = NULL);
     LTE_Shield_error_t gpsEnableSpeed(boolean enable = true);
     LTE_Shield_error_t gpsGetSpeed(struct SpeedData *speed);
 
     LTE_Shield_error_t gpsRequest(unsigned int timeout, uint32_t accuracy, boolean detailed = true);
+    // Unlike gpsRequest(), doesn't turn the GPS off first -- call gpsPowerAsync(false) if needed
+    int gpsRequestAsync(unsigned int timeout, uint32_t accuracy, boolean detailed = true,
+                        LTE_Shield_command_callback_t callback = NULL);
 
 private:
     HardwareSerial *_hardSerial;
 #ifdef LTE_SHIELD_SOFTWARE_SERIAL_ENABLED
     SoftwareSerial *_softSerial;
 #endif
+    Stream *_serialPort; // Whichever of the above was begun, all byte I/O goes through here
 
     uint8_t _powerPin;
     uint8_t _resetPin;
@@ -336,8 +787,18 @@ private:
     IPAddress _lastLocalIP;
 
     void (*_socketReadCallback)(int, String);
+    void (*_socketDataCallback)(int, const uint8_t *, size_t);
     void (*_socketCloseCallback)(int);
+    void (*_socketRecvFromCallback)(int, const uint8_t *, size_t, IPAddress, unsigned int);
+    uint8_t *_recvFromBuffer;
+    size_t _recvFromBufferSize;
+    void (*_socketConnectCallback)(int, int, unsigned long);
     void (*_gpsRequestCallback)(ClockData, PositionData, SpeedData, unsigned long);
+    void (*_sleepCallback)(boolean);
+
+    boolean _asleep;
+    boolean _wakeRequested;
+    unsigned long _wakeTime;
 
     typedef enum
     {
@@ -354,7 +815,230 @@ private:
         SILENT_RESET_W_SIM = 16
     } LTE_Shield_functionality_t;
 
+    // Asynchronous command engine
+    typedef enum
+    {
+        LTE_SHIELD_COMMAND_FREE,
+        LTE_SHIELD_COMMAND_QUEUED,
+        LTE_SHIELD_COMMAND_WAIT_PROMPT,
+        LTE_SHIELD_COMMAND_WAIT_RESPONSE,
+        LTE_SHIELD_COMMAND_COMPLETE
+    } LTE_Shield_command_state_t;
+
+    // Parses a complete response into the command's result pointers
+    typedef LTE_Shield_error_t (*LTE_Shield_response_parser_t)(char *response, void **results, int arg);
+
+    struct LTE_Shield_command_t
+    {
+        int handle;
+        LTE_Shield_command_state_t state;
+        char command[LTE_SHIELD_MAX_COMMAND_LENGTH];
+        uint8_t commandLength;
+        boolean commandOverflow;     // Builder ran out of room, command won't be sent
+        boolean at;
+        const char *prompt;          // If set, wait for this before sending payload
+        const char *payload;         // Written after the prompt, or on the command line if there's none
+        const char *argument;        // Quoted string too long for command[], written from here when sent
+        uint8_t argumentAt;          // Where in command[] it goes
+        size_t payloadLength;
+        char payloadTerminator;      // Written after the payload if non-zero
+        const char *expectedResponse;
+        char *response;              // Capture buffer
+        size_t responseSize;
+        size_t responseLength;
+        size_t lineStart;            // Where the line being received starts in response
+        boolean responseOverflow;    // Something didn't fit in the capture buffer
+        boolean lineOverflow;        // The line being captured didn't fit, unless it turns out to be a URC
+        boolean recordOverflow;      // The record being captured didn't fit
+        boolean strictCapture;       // Report responseOverflow as an error even without a parser
+        char *dataDest;              // Quoted response data is copied here rather than captured
+        size_t dataSize;
+        size_t dataLength;
+        size_t dataIndex;
+        boolean inData;
+        boolean dataDone;
+        uint8_t dataSkipQuotes;      // Quotes before the data's own, e.g. around the +USORF address
+        boolean hex;                 // Payload and quoted data are two hex digits per byte
+        size_t matchIndex;
+        unsigned long timeout;
+        unsigned long startTime;
+        unsigned int charsRead;
+        LTE_Shield_response_parser_t parser;
+        LTE_Shield_response_parser_t recordParser; // If set, called on each record as it completes
+        char recordDelimiter;
+        void *results[LTE_SHIELD_MAX_COMMAND_RESULTS];
+        int resultArg;
+        LTE_Shield_error_t result;
+        LTE_Shield_command_callback_t callback;
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+        unsigned long sentTime; // startTime is reset by the prompt, this isn't
+#endif
+    };
+
+    LTE_Shield_command_t _commands[LTE_SHIELD_MAX_PENDING_COMMANDS];
+    LTE_Shield_command_t *_activeCommand;
+    int _nextHandle;
+    unsigned long _commandsSent;
+    struct InitStats _initStats;
+    boolean _freshBoot; // Modem has just restarted, so no sockets can be open
+    lte_shield_data_mode_t _dataMode;
+    uint8_t _socketFlags[LTE_SHIELD_NUM_SOCKETS];
+    unsigned int _socketUnread[LTE_SHIELD_NUM_SOCKETS]; // Announced by +UUSORD/+UUSORF, not yet read
+    unsigned long _socketConnectStart[LTE_SHIELD_NUM_SOCKETS]; // When a background connect was accepted
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    struct LTE_Shield_tx_buffer_t
+    {
+        uint8_t *data; // NULL when the socket isn't buffered
+        size_t size;
+        size_t length;
+        size_t threshold;
+        unsigned long maxLatency;
+        unsigned long firstWrite; // When the oldest byte waiting was written
+        int flushHandle;          // Write poll() queued, valid while flushLength > 0
+        size_t flushLength;
+        size_t flushWritten;
+        unsigned long retryStart; // When the last flush failed
+        unsigned long retryDelay; // 0 unless backing off after a failed flush
+        unsigned long writes;
+        unsigned long flushes;
+        unsigned long bytes;
+    };
+    LTE_Shield_tx_buffer_t _txBuffers[LTE_SHIELD_NUM_SOCKETS];
+#endif
+    struct LTE_Shield_dns_entry_t
+    {
+        char host[LTE_SHIELD_DNS_HOST_SIZE]; // Empty if the entry is unused
+        uint8_t ip[4];
+        unsigned long resolved; // millis() of the lookup
+    };
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    LTE_Shield_dns_entry_t _dnsCache[LTE_SHIELD_DNS_CACHE_SIZE];
+#endif
+    unsigned long _dnsTtl;
+    unsigned long _dnsHits;
+    unsigned long _dnsMisses;
+    unsigned long _dnsFailures;
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    boolean _txFlushing; // Keeps poll() from starting a flush while socketFlush() waits on the modem
+#endif
+    int8_t _modemDataMode; // What the module was last set to, -1 if we don't know
+    boolean _directLink;   // The UART is a raw pipe to a socket, not AT commands
+    unsigned long _directLinkStart;
+    unsigned long _directLinkEnd;
+    unsigned long _directLinkLastTx;
+    unsigned long _directLinkSent;
+    unsigned long _directLinkReceived;
+    int _lastErrorCode;
+    char _responseBuffer[LTE_SHIELD_RESPONSE_BUFFER_SIZE];
+
+    LTE_Shield_command_t *allocateCommand(const char *expectedResponse, unsigned long timeout,
+                                          LTE_Shield_command_callback_t callback);
+    void appendCommand(LTE_Shield_command_t *cmd, const char *str);
+    void appendCommand(LTE_Shield_command_t *cmd, char c);
+    void appendCommandInt(LTE_Shield_command_t *cmd, long value);
+    void appendCommandUnsigned(LTE_Shield_command_t *cmd, unsigned long value);
+    void appendCommandQuoted(LTE_Shield_command_t *cmd, const char *str);
+    int submitCommand(LTE_Shield_command_t *cmd);
+    LTE_Shield_command_t *findCommand(int handle);
+    LTE_Shield_command_t *nextQueuedCommand(void);
+    unsigned int commandAge(LTE_Shield_command_t *cmd);
+    void startCommand(LTE_Shield_command_t *cmd);
+    void sendCommandLine(LTE_Shield_command_t *cmd, boolean terminate);
+    void processCommands(void);
+    void processCommandChar(LTE_Shield_command_t *cmd, char c);
+    void startCommandData(LTE_Shield_command_t *cmd);
+    void sendPayload(LTE_Shield_command_t *cmd);
+    void completeCommand(LTE_Shield_command_t *cmd, LTE_Shield_error_t err);
+    LTE_Shield_error_t checkFinalResult(const char *line);
+#if LTE_SHIELD_ENABLE_COMMAND_STATS
+    struct CommandStats _commandStats[LTE_SHIELD_STATS_VERBS];
+    uint8_t _commandStatsUsed;
+    void recordCommandStats(LTE_Shield_command_t *cmd, LTE_Shield_error_t err);
+#endif
+    boolean isCommandReply(LTE_Shield_command_t *cmd, const char *line);
+    int startSocketRead(int socket, int length, char *readDest, int *readLength,
+                        LTE_Shield_command_callback_t callback = NULL);
+    // +USOWR if address is NULL, otherwise +USOST
+    int startSocketWrite(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length,
+                         size_t *written, LTE_Shield_command_callback_t callback);
+    // Queues writes of up to chunkMax bytes back to back, as many at once as there are command slots
+    int sendChunks(int socket, const char *address, unsigned int port, const uint8_t *data, size_t length,
+                   size_t chunkMax);
+    int syncDataMode(void);
+#if LTE_SHIELD_DNS_CACHE_SIZE > 0
+    LTE_Shield_dns_entry_t *findDnsEntry(const char *host);
+#endif
+    // address itself if it's already an IP, or has no fresh cache entry, otherwise the cached IP in ipString
+    const char *cachedAddress(const char *address, char *ipString);
+    // length < 0 reads until the module runs out, a NULL consumer means the socket read callbacks
+    int drainSocket(int socket, int length, char *buffer, size_t chunkSize,
+                    void (*consumer)(int, const uint8_t *, size_t));
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    int bufferSocketWrite(int socket, const uint8_t *data, size_t length);
+    void flushDueSocketBuffers(void);
+    // Settles a write poll() queued, waiting for it if it's still with the modem
+    void collectSocketFlush(LTE_Shield_tx_buffer_t *tx);
+    // Drops what was sent from the front of the buffer, backs off retries if failed
+    void finishSocketFlush(LTE_Shield_tx_buffer_t *tx, size_t sent, boolean failed);
+#endif
+
+#if LTE_SHIELD_ENABLE_TRACE
+    // Serial trace ring, whole records between _traceTail and _traceHead
+    uint8_t _trace[LTE_SHIELD_TRACE_SIZE];
+    unsigned int _traceHead;
+    unsigned int _traceTail;
+    unsigned long _traceLastTime;
+    boolean _traceEnabled;
+    void traceRecord(boolean tx, uint8_t c);
+    unsigned int traceRecordLength(unsigned int index);
+#endif
+
+    // Receive ring buffer and line assembly for unsolicited result codes
+    char _rxBuffer[LTE_SHIELD_RX_BUFFER_SIZE];
+    unsigned int _rxHead;
+    unsigned int _rxTail;
+    char _rxLine[LTE_SHIELD_RX_LINE_SIZE];
+    unsigned int _rxLineLength;
+    boolean _rxLineOverflow;
+
+    void fillRxBuffer(void);
+    char rxRead(void);
+    boolean assembleLine(char c);
+    boolean processUrcLine(const char *line);
+    int findUrcHandler(const char *line, const char **params);
+    boolean queueUrcLine(const char *line);
+    boolean processUrcQueue(void);
+
+    char _urcQueue[LTE_SHIELD_URC_QUEUE_SIZE]; // Null-terminated lines, oldest first
+    size_t _urcQueueLength;
+    unsigned long _droppedUrcs;
+
+    // URC dispatch -- built-in handlers return true if the line was understood
+    struct LTE_Shield_urc_handler_t
+    {
+        const char *prefix;
+        boolean (LTE_Shield::*handler)(const char *params);
+    };
+    static const LTE_Shield_urc_handler_t _urcHandlers[];
+
+    struct LTE_Shield_user_urc_handler_t
+    {
+        const char *prefix;
+        void (*handler)(const char *params);
+    };
+    LTE_Shield_user_urc_handler_t _userUrcHandlers[LTE_SHIELD_MAX_URC_HANDLERS];
+
+    boolean urcSocketRead(const char *params);
+    boolean urcSocketRecvFrom(const char *params);
+    boolean urcSocketListen(const char *params);
+    boolean urcSocketClose(const char *params);
+    boolean urcSocketConnect(const char *params);
+    boolean urcLocation(const char *params);
+    boolean urcPowerSaving(const char *params);
+
     LTE_Shield_error_t init(unsigned long baud, LTE_Shield_init_type_t initType = LTE_SHIELD_INIT_STANDARD);
+    void configure(void);
+    void closeAllSockets(void);
 
     void powerOn(void);
 
@@ -365,17 +1049,18 @@ private:
     LTE_Shield_error_t setMno(mobile_network_operator_t mno);
     LTE_Shield_error_t getMno(mobile_network_operator_t *mno);
 
-    // Wait for an expected response (don't send a command)
-    LTE_Shield_error_t waitForResponse(const char *expectedResponse, uint16_t timeout);
-
-    // Send command with an expected (potentially partial) response, store entire response
+    // Send command with an expected (potentially partial) response, store entire response.
+    // At most destSize - 1 characters are stored in responseDest, always null-terminated.
+    // Returns LTE_SHIELD_ERROR_RESPONSE_OVERFLOW if the response was cut short.
     LTE_Shield_error_t sendCommandWithResponse(const char *command, const char *expectedResponse,
-                                               char *responseDest, unsigned long commandTimeout, boolean at = true);
+                                               char *responseDest, size_t destSize,
+                                               unsigned long commandTimeout, boolean at = true);
 
     // Send a command -- prepend AT if at is true
-    boolean sendCommand(const char *command, boolean at);
+    boolean sendCommand(const char *command, boolean at, boolean terminate = true);
 
     LTE_Shield_error_t parseSocketReadIndication(int socket, int length);
+    LTE_Shield_error_t parseSocketRecvFromIndication(int socket, int length);
     LTE_Shield_error_t parseSocketListenIndication(IPAddress localIP, IPAddress remoteIP);
     LTE_Shield_error_t parseSocketCloseIndication(String *closeIndication);
 
@@ -390,8 +1075,12 @@ private:
     bool find(char *target);
 
     LTE_Shield_error_t autobaud(unsigned long desiredBaud);
-
-    char *lte_calloc_char(size_t num);
+    LTE_Shield_error_t probeBaud(unsigned long baud);
+    LTE_Shield_error_t ping(void);
+    boolean waitForModem(unsigned long budget, boolean rebooted, struct RecoveryResult *result);
+    LTE_Shield_baud_load_t _baudLoad;
+    LTE_Shield_baud_save_t _baudSave;
+    unsigned long _storedBaud;
 };
 
-#endif //SPARKFUN_LTE_SHIELD_ARDUINO_LIBRARY_H
\ No newline at end of file
+#endif //SPARKFUN_LTE_SHIELD_ARDUINO_LIBRARY_H
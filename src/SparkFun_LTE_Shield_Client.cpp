@@ -0,0 +1,189 @@
+/*
+  Arduino Client for the SparkFun LTE Shield Arduino Library
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SparkFun_LTE_Shield_Client.h"
+
+LTE_ShieldClient::LTE_ShieldClient(LTE_Shield &lte)
+{
+    _lte = &lte;
+    _socket = -1;
+    _rxTail = 0;
+    _rxCount = 0;
+}
+
+int LTE_ShieldClient::socket(void)
+{
+    return _socket;
+}
+
+int LTE_ShieldClient::connect(IPAddress ip, uint16_t port)
+{
+    char address[16];
+
+    sprintf(address, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+    return connect(address, port);
+}
+
+int LTE_ShieldClient::connect(const char *host, uint16_t port)
+{
+    if (_socket >= 0)
+        stop();
+
+    _socket = _lte->socketOpen(LTE_SHIELD_TCP);
+    if (_socket < 0)
+        return 0;
+    // Leave received data on the module until it's read
+    _lte->deferSocketRead(_socket, true);
+    if (_lte->socketConnect(_socket, host, port) != LTE_SHIELD_ERROR_SUCCESS)
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+size_t LTE_ShieldClient::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t LTE_ShieldClient::write(const uint8_t *buf, size_t size)
+{
+    int written;
+
+    if ((_socket < 0) || (size == 0))
+        return 0;
+    written = _lte->socketWrite(_socket, buf, size);
+    if (written < 0)
+    {
+        setWriteError();
+        return 0;
+    }
+    return written;
+}
+
+int LTE_ShieldClient::available(void)
+{
+    if (_socket < 0)
+        return 0;
+    _lte->poll(); // Pick up any +UUSORD
+    return _rxCount + _lte->socketAvailable(_socket);
+}
+
+int LTE_ShieldClient::read(void)
+{
+    if ((_rxCount == 0) && (fill() == 0))
+        return -1;
+    _rxCount--;
+    return _rx[_rxTail++];
+}
+
+int LTE_ShieldClient::read(uint8_t *buf, size_t size)
+{
+    size_t copied;
+    int readMax = (_lte->socketDataMode() == LTE_SHIELD_DATA_MODE_HEX) ? LTE_SHIELD_SOCKET_READ_MAX_HEX
+                                                                       : LTE_SHIELD_SOCKET_READ_MAX;
+
+    // Whatever the receive buffer already holds goes first
+    copied = (size < _rxCount) ? size : _rxCount;
+    memcpy(buf, &_rx[_rxTail], copied);
+    _rxTail += copied;
+    _rxCount -= copied;
+
+    // Then the rest straight off the module into buf, only as much as was asked for
+    if ((_socket >= 0) && (copied < size) && (_lte->socketAvailable(_socket) == 0))
+        _lte->poll();
+    while ((_socket >= 0) && (copied < size))
+    {
+        int length = _lte->socketAvailable(_socket);
+        int readLength = 0;
+
+        if ((size_t)length > size - copied)
+            length = size - copied;
+        if (length > readMax)
+            length = readMax;
+        if (length <= 0)
+            break;
+        if ((_lte->socketRead(_socket, length, (char *)buf + copied, &readLength) != LTE_SHIELD_ERROR_SUCCESS) ||
+            (readLength <= 0))
+            break;
+        copied += readLength;
+    }
+
+    return (copied > 0) ? (int)copied : -1;
+}
+
+int LTE_ShieldClient::peek(void)
+{
+    if ((_rxCount == 0) && (fill() == 0))
+        return -1;
+    return _rx[_rxTail];
+}
+
+void LTE_ShieldClient::flush(void)
+{
+#if LTE_SHIELD_ENABLE_WRITE_BUFFER
+    // Only holds anything back if the socket has a write buffer, see LTE_Shield::setSocketWriteBuffer()
+    if (_socket >= 0)
+        _lte->socketFlush(_socket);
+#endif
+}
+
+void LTE_ShieldClient::stop(void)
+{
+    if (_socket >= 0)
+    {
+        _lte->socketClose(_socket);
+        _socket = -1;
+    }
+    _rxTail = 0;
+    _rxCount = 0;
+}
+
+uint8_t LTE_ShieldClient::connected(void)
+{
+    if (_socket < 0)
+        return 0;
+    // Data the module already handed over can still be read after the far end closes
+    if (_rxCount > 0)
+        return 1;
+    _lte->poll(); // Pick up any +UUSOCL
+    return !_lte->socketClosed(_socket);
+}
+
+LTE_ShieldClient::operator bool(void)
+{
+    return _socket >= 0;
+}
+
+int LTE_ShieldClient::fill(void)
+{
+    int length;
+    int readLength = 0;
+
+    // Only called once the buffer is empty, so each fill is one +USORD into the whole of it
+    if (_socket < 0)
+        return 0;
+    if (_lte->socketAvailable(_socket) == 0)
+        _lte->poll();
+    length = _lte->socketAvailable(_socket);
+    if (length > LTE_SHIELD_CLIENT_RX_BUFFER_SIZE)
+        length = LTE_SHIELD_CLIENT_RX_BUFFER_SIZE;
+    if (length <= 0)
+        return 0;
+
+    if ((_lte->socketRead(_socket, length, (char *)_rx, &readLength) != LTE_SHIELD_ERROR_SUCCESS) ||
+        (readLength <= 0))
+        return 0;
+    _rxTail = 0;
+    _rxCount = readLength;
+    return readLength;
+}
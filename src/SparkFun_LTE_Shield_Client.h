@@ -0,0 +1,65 @@
+/*
+  Arduino Client for the SparkFun LTE Shield Arduino Library
+
+  Wraps one TCP socket in the Arduino Client interface, so libraries that
+  take a Client (MQTT, HTTP...) can run over the shield. Received data is
+  left on the module until it's asked for: +UUSORD only records how much
+  is waiting, single byte reads are served from a small receive buffer
+  that is refilled with one +USORD at a time, and read(buf, len) fetches
+  straight into the caller's buffer.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARKFUN_LTE_SHIELD_CLIENT_H
+#define SPARKFUN_LTE_SHIELD_CLIENT_H
+
+#include "SparkFun_LTE_Shield_Arduino_Library.h"
+#include <Client.h>
+
+#ifndef LTE_SHIELD_CLIENT_RX_BUFFER_SIZE
+#define LTE_SHIELD_CLIENT_RX_BUFFER_SIZE 64 // Per client, read() and peek() fetch up to this much at once
+#endif
+
+class LTE_ShieldClient : public Client
+{
+public:
+    LTE_ShieldClient(LTE_Shield &lte);
+
+    // The module's socket number, -1 if not connected
+    int socket(void);
+
+    // Client
+    virtual int connect(IPAddress ip, uint16_t port);
+    virtual int connect(const char *host, uint16_t port);
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buf, size_t size);
+    virtual int available(void);
+    virtual int read(void);
+    virtual int read(uint8_t *buf, size_t size);
+    virtual int peek(void);
+    virtual void flush(void);
+    virtual void stop(void);
+    virtual uint8_t connected(void);
+    virtual operator bool(void);
+    using Print::write;
+
+private:
+    LTE_Shield *_lte;
+    int _socket;
+
+    // Bytes fetched but not yet read are the _rxCount from _rx[_rxTail]
+    uint8_t _rx[LTE_SHIELD_CLIENT_RX_BUFFER_SIZE];
+    unsigned int _rxTail;
+    unsigned int _rxCount;
+
+    // Refill the empty receive buffer from the module, returns the bytes fetched
+    int fill(void);
+};
+
+#endif // SPARKFUN_LTE_SHIELD_CLIENT_H
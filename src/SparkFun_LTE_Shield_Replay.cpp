@@ -0,0 +1,200 @@
+/*
+  Serial trace replay for the SparkFun LTE Shield Arduino Library
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SparkFun_LTE_Shield_Replay.h"
+
+LTE_Shield_Replay::LTE_Shield_Replay(const uint8_t *trace, size_t length, float speed)
+{
+    _trace = trace;
+    _length = length;
+    _speed = speed;
+    restart();
+}
+
+void LTE_Shield_Replay::setSpeed(float speed)
+{
+    _speed = speed;
+}
+
+void LTE_Shield_Replay::restart(void)
+{
+    _rxIndex = 0;
+    _rxTime = 0;
+    _txIndex = 0;
+    _txTime = 0;
+    _anchorTrace = 0;
+    _anchorReal = micros();
+    _mismatches = 0;
+}
+
+boolean LTE_Shield_Replay::finished(void)
+{
+    boolean tx;
+    unsigned long delta;
+    uint8_t data;
+    size_t index;
+
+    skipSent();
+    index = _rxIndex;
+    while (index < _length)
+    {
+        index = decode(index, &tx, &delta, &data);
+        if (!tx)
+            return false;
+    }
+    return true;
+}
+
+unsigned long LTE_Shield_Replay::mismatches(void)
+{
+    return _mismatches;
+}
+
+int LTE_Shield_Replay::available(void)
+{
+    boolean tx;
+    unsigned long delta;
+    uint8_t data;
+    size_t index;
+    unsigned long time;
+    int count = 0;
+
+    skipSent();
+
+    // Count the received bytes at the cursor that are due
+    index = _rxIndex;
+    time = _rxTime;
+    while (index < _length)
+    {
+        size_t next = decode(index, &tx, &delta, &data);
+        time += (index == 0) ? 0 : delta;
+        if (tx || !due(time))
+            break;
+        count++;
+        index = next;
+    }
+    return count;
+}
+
+int LTE_Shield_Replay::read(void)
+{
+    boolean tx;
+    unsigned long delta;
+    uint8_t data;
+    size_t next;
+
+    if (!rxReady(&data))
+        return -1;
+
+    next = decode(_rxIndex, &tx, &delta, &data);
+    _rxTime += (_rxIndex == 0) ? 0 : delta;
+    _rxIndex = next;
+    return data;
+}
+
+int LTE_Shield_Replay::peek(void)
+{
+    uint8_t data;
+
+    return rxReady(&data) ? data : -1;
+}
+
+void LTE_Shield_Replay::flush(void)
+{
+}
+
+size_t LTE_Shield_Replay::write(uint8_t c)
+{
+    boolean tx = false;
+    unsigned long delta;
+    uint8_t data;
+
+    // Find the next byte the library sent in the recording
+    while (_txIndex < _length)
+    {
+        size_t next = decode(_txIndex, &tx, &delta, &data);
+        _txTime += (_txIndex == 0) ? 0 : delta;
+        _txIndex = next;
+        if (tx)
+            break;
+    }
+    if (!tx)
+    {
+        _mismatches++; // Ran off the end of the recording
+        return 1;
+    }
+    if (data != c)
+        _mismatches++;
+
+    // Received bytes are timed from when the library really sent what came before them
+    _anchorTrace = _txTime;
+    _anchorReal = micros();
+    return 1;
+}
+
+size_t LTE_Shield_Replay::decode(size_t index, boolean *tx, unsigned long *delta, uint8_t *data)
+{
+    uint8_t header = _trace[index++];
+    uint8_t shift = 6;
+
+    *tx = (header & LTE_SHIELD_TRACE_TX) != 0;
+    *delta = header & LTE_SHIELD_TRACE_DELTA_MASK;
+    if (header & LTE_SHIELD_TRACE_EXTENDED)
+    {
+        while (index < _length)
+        {
+            uint8_t b = _trace[index++];
+            *delta |= (unsigned long)(b & 0x7F) << shift;
+            shift += 7;
+            if (!(b & 0x80))
+                break;
+        }
+    }
+    *data = (index < _length) ? _trace[index] : 0;
+    return index + 1;
+}
+
+void LTE_Shield_Replay::skipSent(void)
+{
+    boolean tx;
+    unsigned long delta;
+    uint8_t data;
+
+    // Step over bytes the library has already sent, the next received byte is held until it has
+    while ((_rxIndex < _txIndex) && (_rxIndex < _length))
+    {
+        size_t next = decode(_rxIndex, &tx, &delta, &data);
+        if (!tx)
+            break;
+        _rxTime += (_rxIndex == 0) ? 0 : delta;
+        _rxIndex = next;
+    }
+}
+
+boolean LTE_Shield_Replay::rxReady(uint8_t *data)
+{
+    boolean tx;
+    unsigned long delta;
+
+    // Only the record at the cursor, available() counting every due byte would make reads quadratic
+    skipSent();
+    if (_rxIndex >= _length)
+        return false;
+    decode(_rxIndex, &tx, &delta, data);
+    return !tx && due(_rxTime + ((_rxIndex == 0) ? 0 : delta));
+}
+
+boolean LTE_Shield_Replay::due(unsigned long traceTime)
+{
+    if ((_speed <= 0) || (traceTime <= _anchorTrace))
+        return true;
+    return ((float)(micros() - _anchorReal) * _speed) >= (float)(traceTime - _anchorTrace);
+}
@@ -0,0 +1,73 @@
+/*
+  Serial trace replay for the SparkFun LTE Shield Arduino Library
+
+  A Stream that plays back a trace recorded with LTE_Shield::traceCopy() or
+  traceDump() (build the library with LTE_SHIELD_ENABLE_TRACE=1). Bytes the
+  module sent are released to the library at their recorded spacing, scaled
+  by the replay speed, and never before the library has sent everything
+  that preceded them in the recording. Bytes the library sends are checked
+  against the recording.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARKFUN_LTE_SHIELD_REPLAY_H
+#define SPARKFUN_LTE_SHIELD_REPLAY_H
+
+#include "SparkFun_LTE_Shield_Arduino_Library.h"
+
+class LTE_Shield_Replay : public Stream
+{
+public:
+    // speed 1.0 replays at the recorded pace, 10.0 ten times faster,
+    // 0 as fast as the library reads
+    LTE_Shield_Replay(const uint8_t *trace, size_t length, float speed = 1.0);
+
+    void setSpeed(float speed);
+    // Start again from the first record
+    void restart(void);
+    // Every received byte in the recording has been delivered
+    boolean finished(void);
+    // Bytes the library sent that differ from, or go beyond, the recording
+    unsigned long mismatches(void);
+
+    // Stream
+    virtual int available(void);
+    virtual int read(void);
+    virtual int peek(void);
+    virtual void flush(void);
+    virtual size_t write(uint8_t c);
+    using Print::write;
+
+private:
+    const uint8_t *_trace;
+    size_t _length;
+    float _speed;
+
+    // Separate cursors for the bytes we deliver and the bytes we expect,
+    // each with the trace time (us) of the record before it
+    size_t _rxIndex;
+    unsigned long _rxTime;
+    size_t _txIndex;
+    unsigned long _txTime;
+
+    // Recorded time of the last byte the library sent, and when it really sent it
+    unsigned long _anchorTrace;
+    unsigned long _anchorReal;
+
+    unsigned long _mismatches;
+
+    // Decode the record at index, returns the index of the next one
+    size_t decode(size_t index, boolean *tx, unsigned long *delta, uint8_t *data);
+    void skipSent(void);
+    // The received byte at the cursor is due, data is set to it
+    boolean rxReady(uint8_t *data);
+    boolean due(unsigned long traceTime);
+};
+
+#endif // SPARKFUN_LTE_SHIELD_REPLAY_H
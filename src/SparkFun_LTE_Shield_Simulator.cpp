@@ -0,0 +1,792 @@
+/*
+  Simulated SARA-R410M for the SparkFun LTE Shield Arduino Library
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SparkFun_LTE_Shield_Simulator.h"
+
+#define SIM_RESULT_OK 0
+#define SIM_RESULT_ERROR -1
+#define SIM_RESULT_PROMPT -2 // Final result follows the payload
+
+#define SIM_CME_NOT_ALLOWED 3
+#define SIM_CME_INVALID_PARAM 50
+#define SIM_CME_DNS_FAILED 8 // Socket error reported when a name doesn't resolve
+
+#define SIM_CTRL_Z 0x1A
+#define SIM_ESCAPE_GUARD 1000 // Silence needed either side of "+++" in direct link
+
+// Canned replies, in the format a SARA-R410M-02B uses
+static const char SIM_RMC_SENTENCE[] =
+    "$GPRMC,083055.00,A,4003.12345,N,10512.12345,W,0.015,,291118,,,D*6E";
+static const char SIM_HEX_DIGITS[] = "0123456789ABCDEF";
+static const char SIM_OPERATORS[] =
+    "(1,\"313 100\",\"313 100\",\"313100\",8),(2,\"AT&T\",\"AT&T\",\"310410\",8),"
+    "(3,\"311 480\",\"311 480\",\"311480\",8),,(0,1,2,3,4),(0,1,2)";
+
+LTE_Shield_Simulator::LTE_Shield_Simulator(void)
+{
+    _outputHead = 0;
+    _outputTail = 0;
+    _outputDropped = 0;
+    _latency = 0;
+    _byteRate = 0;
+    _readyTime = 0;
+    _readSinceReady = 0;
+    _lineLength = 0;
+    _echo = true;
+    _loopback = false;
+    _hexMode = false;
+    _payloadSocket = -1;
+    _payloadSendTo = false;
+    _payloadRemaining = 0;
+    _payloadLength = 0;
+    _smsPayload = false;
+    _hexPayload = false;
+    _payloadDigits = 0;
+    _directLinkSocket = -1;
+    _escapeCount = 0;
+    _escapeTime = 0;
+    _lastHostByte = 0;
+    memset(_socketOpen, 0, sizeof(_socketOpen));
+    memset(_socketUdp, 0, sizeof(_socketUdp));
+    memset(_socketConnecting, 0, sizeof(_socketConnecting));
+    memset(_connectDue, 0, sizeof(_connectDue));
+    _connectTime = 500;
+    memset(_socketPending, 0, sizeof(_socketPending));
+    memset(_datagramCount, 0, sizeof(_datagramCount));
+    memset(_socketOffset, 0, sizeof(_socketOffset));
+    strcpy(_peerAddress, "192.0.2.1");
+    _peerPort = 16666;
+    _commandHandler = NULL;
+    _bytesFromHost = 0;
+    _bytesToHost = 0;
+    _commandsHandled = 0;
+}
+
+void LTE_Shield_Simulator::setLatency(unsigned long latency)
+{
+    _latency = latency;
+}
+
+void LTE_Shield_Simulator::setByteRate(unsigned long bytesPerSecond)
+{
+    _byteRate = bytesPerSecond;
+}
+
+void LTE_Shield_Simulator::setCommandHandler(const char *(*handler)(const char *command))
+{
+    _commandHandler = handler;
+}
+
+void LTE_Shield_Simulator::setConnectTime(unsigned long connectTime)
+{
+    _connectTime = connectTime;
+}
+
+void LTE_Shield_Simulator::setLoopback(boolean loopback)
+{
+    _loopback = loopback;
+}
+
+void LTE_Shield_Simulator::receiveSocketData(int socket, unsigned int length)
+{
+    if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+        return;
+
+    _socketPending[socket] += length;
+    if (_socketUdp[socket] && !queueDatagram(socket, length))
+        return;
+    respond();
+    announceSocketData(socket);
+}
+
+void LTE_Shield_Simulator::sendUrc(const char *urc)
+{
+    respond();
+    output("\r\n");
+    output(urc);
+    output("\r\n");
+}
+
+unsigned long LTE_Shield_Simulator::bytesFromHost(void)
+{
+    return _bytesFromHost;
+}
+
+unsigned long LTE_Shield_Simulator::bytesToHost(void)
+{
+    return _bytesToHost;
+}
+
+unsigned long LTE_Shield_Simulator::commandsHandled(void)
+{
+    return _commandsHandled;
+}
+
+unsigned long LTE_Shield_Simulator::outputDropped(void)
+{
+    return _outputDropped;
+}
+
+int LTE_Shield_Simulator::available(void)
+{
+    unsigned long now = millis();
+    unsigned long allowed;
+    unsigned int used;
+
+    checkEscape();
+    checkConnects();
+    used = outputUsed();
+
+    if ((used == 0) || ((long)(now - _readyTime) < 0))
+        return 0;
+    if (_byteRate == 0)
+        return used;
+
+    // Bytes the UART would have delivered since the response started, less those already read
+    allowed = ((now - _readyTime) * _byteRate) / 1000;
+    allowed = (allowed > _readSinceReady) ? allowed - _readSinceReady : 0;
+    return (allowed < used) ? allowed : used;
+}
+
+int LTE_Shield_Simulator::read(void)
+{
+    char c;
+
+    if (available() == 0)
+        return -1;
+
+    c = _output[_outputTail];
+    _outputTail = (_outputTail + 1) % LTE_SHIELD_SIM_OUTPUT_SIZE;
+    _readSinceReady++;
+    _bytesToHost++;
+    return (uint8_t)c;
+}
+
+int LTE_Shield_Simulator::peek(void)
+{
+    if (available() == 0)
+        return -1;
+    return (uint8_t)_output[_outputTail];
+}
+
+void LTE_Shield_Simulator::flush(void)
+{
+}
+
+size_t LTE_Shield_Simulator::write(uint8_t c)
+{
+    unsigned long now = millis();
+    unsigned long quiet = now - _lastHostByte;
+
+    _bytesFromHost++;
+    _lastHostByte = now;
+
+    if (_directLinkSocket >= 0)
+    {
+        // A '+' only starts an escape after a guard time, and the rest must follow it
+        if ((c == '+') && (_escapeCount < 3) && ((_escapeCount > 0) || (quiet >= SIM_ESCAPE_GUARD)))
+        {
+            _escapeCount++;
+            _escapeTime = now;
+            return 1;
+        }
+        while (_escapeCount > 0)
+        {
+            directLinkByte('+'); // Not an escape after all
+            _escapeCount--;
+        }
+        directLinkByte(c);
+        return 1;
+    }
+
+    if (_payloadRemaining > 0)
+    {
+        if (_loopback && (_payloadSocket >= 0))
+            _socketPending[_payloadSocket]++;
+        if (--_payloadRemaining == 0)
+            finishPayload();
+        return 1;
+    }
+    if (_smsPayload)
+    {
+        if (c == SIM_CTRL_Z)
+            finishPayload();
+        return 1;
+    }
+    if (_hexPayload)
+    {
+        // Two digits per byte up to the closing quote, the '\r' ends the command
+        if (c == '\r')
+        {
+            finishPayload();
+        }
+        else if (isxdigit(c))
+        {
+            if ((++_payloadDigits % 2 == 0) && _loopback && (_payloadSocket >= 0))
+                _socketPending[_payloadSocket]++;
+        }
+        return 1;
+    }
+
+    if (_echo)
+    {
+        respond();
+        output((char)c);
+    }
+
+    if (c == '\r')
+    {
+        _line[_lineLength] = '\0';
+        handleLine();
+        _lineLength = 0;
+    }
+    else if ((c != '\n') && (_lineLength < LTE_SHIELD_SIM_LINE_SIZE - 1))
+    {
+        _line[_lineLength++] = c;
+        if (_hexMode && (c == '\"'))
+            startHexPayload();
+    }
+    return 1;
+}
+
+unsigned int LTE_Shield_Simulator::outputUsed(void)
+{
+    return (_outputHead + LTE_SHIELD_SIM_OUTPUT_SIZE - _outputTail) % LTE_SHIELD_SIM_OUTPUT_SIZE;
+}
+
+void LTE_Shield_Simulator::output(const char *str)
+{
+    while (*str != '\0')
+    {
+        output(*str++);
+    }
+}
+
+void LTE_Shield_Simulator::output(char c)
+{
+    unsigned int next = (_outputHead + 1) % LTE_SHIELD_SIM_OUTPUT_SIZE;
+
+    if (next == _outputTail)
+    {
+        _outputDropped++;
+        return;
+    }
+    _output[_outputHead] = c;
+    _outputHead = next;
+}
+
+void LTE_Shield_Simulator::outputInt(long value)
+{
+    char num[12];
+
+    sprintf(num, "%ld", value);
+    output(num);
+}
+
+void LTE_Shield_Simulator::respond(void)
+{
+    // New output only waits out the latency if nothing is already flowing
+    if (outputUsed() == 0)
+    {
+        _readyTime = millis() + _latency;
+        _readSinceReady = 0;
+    }
+}
+
+void LTE_Shield_Simulator::handleLine(void)
+{
+    char *command = _line;
+    char *next;
+    const char *scripted;
+    int result = SIM_RESULT_OK;
+
+    if (((command[0] != 'A') && (command[0] != 'a')) ||
+        ((command[1] != 'T') && (command[1] != 't')))
+    {
+        return; // Not a command line, the modem ignores it
+    }
+    command += 2;
+    _commandsHandled++;
+    respond();
+
+    if (_commandHandler != NULL)
+    {
+        scripted = _commandHandler(command);
+        if (scripted != NULL)
+        {
+            output(scripted);
+            return;
+        }
+    }
+
+    // Concatenated commands run in order, the first failure ends the line
+    while ((command != NULL) && (result == SIM_RESULT_OK))
+    {
+        next = strchr(command, ';');
+        if (next != NULL)
+            *next++ = '\0';
+        result = handleCommand(command);
+        command = next;
+    }
+
+    if (result == SIM_RESULT_OK)
+    {
+        output("\r\nOK\r\n");
+    }
+    else if (result > 0)
+    {
+        output("\r\n+CME ERROR: ");
+        outputInt(result);
+        output("\r\n");
+    }
+    else if (result == SIM_RESULT_ERROR)
+    {
+        output("\r\nERROR\r\n");
+    }
+}
+
+int LTE_Shield_Simulator::handleCommand(char *command)
+{
+    int socket = -1;
+    unsigned int length = 0;
+    unsigned int room;
+    boolean datagramDone;
+
+    if (command[0] == '\0')
+    {
+        return SIM_RESULT_OK;
+    }
+    else if ((command[0] == 'E') || (command[0] == 'e'))
+    {
+        _echo = (command[1] == '1');
+    }
+    else if ((command[0] == 'I') || (strcmp(command, "+CGMM") == 0))
+    {
+        output("\r\nSARA-R410M-02B\r\n");
+    }
+    else if (strcmp(command, "+CGMI") == 0)
+    {
+        output("\r\nu-blox\r\n");
+    }
+    else if (strcmp(command, "+CGMR") == 0)
+    {
+        output("\r\nL0.0.00.00.05.06 [Feb 03 2018 13:00:41]\r\n");
+    }
+    else if (strcmp(command, "+CGSN") == 0)
+    {
+        output("\r\n352753090041680\r\n");
+    }
+    else if (strcmp(command, "+CIMI") == 0)
+    {
+        output("\r\n310410123456789\r\n");
+    }
+    else if (strcmp(command, "+CCID") == 0)
+    {
+        output("\r\n+CCID: 8901410123456789012\r\n");
+    }
+    else if (strcmp(command, "+CSQ") == 0)
+    {
+        output("\r\n+CSQ: 19,99\r\n");
+    }
+    else if (strcmp(command, "+CREG?") == 0)
+    {
+        output("\r\n+CREG: 0,1\r\n");
+    }
+    else if (strcmp(command, "+CCLK?") == 0)
+    {
+        output("\r\n+CCLK: \"18/11/29,08:30:55-28\"\r\n");
+    }
+    else if (strcmp(command, "+UMNOPROF?") == 0)
+    {
+        output("\r\n+UMNOPROF: 2\r\n");
+    }
+    else if (strcmp(command, "+COPS?") == 0)
+    {
+        output("\r\n+COPS: 0,0,\"AT&T\",8\r\n");
+    }
+    else if (strcmp(command, "+COPS=?") == 0)
+    {
+        output("\r\n+COPS: ");
+        output(SIM_OPERATORS);
+        output("\r\n");
+    }
+    else if (strcmp(command, "+CGDCONT?") == 0)
+    {
+        output("\r\n+CGDCONT: 1,\"IP\",\"hologram\",\"10.170.241.191\",0,0,0,0\r\n");
+    }
+    else if (strcmp(command, "+UGPS?") == 0)
+    {
+        output("\r\n+UGPS: 1,0,1\r\n");
+    }
+    else if (strcmp(command, "+UGRMC?") == 0)
+    {
+        output("\r\n+UGRMC: 1,");
+        output(SIM_RMC_SENTENCE);
+        output("\r\n");
+    }
+    else if (strncmp(command, "+USOCR=", 7) == 0)
+    {
+        for (socket = 0; socket < LTE_SHIELD_SIM_NUM_SOCKETS; socket++)
+        {
+            if (!_socketOpen[socket])
+                break;
+        }
+        if (socket == LTE_SHIELD_SIM_NUM_SOCKETS)
+            return SIM_CME_NOT_ALLOWED;
+        _socketOpen[socket] = true;
+        _socketUdp[socket] = (atoi(command + 7) == 17);
+        _socketPending[socket] = 0;
+        _datagramCount[socket] = 0;
+        _socketOffset[socket] = 0;
+        output("\r\n+USOCR: ");
+        outputInt(socket);
+        output("\r\n");
+    }
+    else if (sscanf(command, "+USOCL=%d", &socket) == 1)
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+        _socketOpen[socket] = false;
+        _socketConnecting[socket] = false;
+    }
+    else if (sscanf(command, "+USOCO=%d,\"%*[^\"]\",%*u,%u", &socket, &length) == 2)
+    {
+        // Async mode, OK now and +UUSOCO once connected
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket] ||
+            _socketConnecting[socket] || (length != 1))
+            return SIM_CME_NOT_ALLOWED;
+        _socketConnecting[socket] = true;
+        _connectDue[socket] = millis() + _connectTime;
+    }
+    else if ((sscanf(command, "+USOCO=%d", &socket) == 1) ||
+             (sscanf(command, "+USOLI=%d", &socket) == 1))
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+    }
+    else if (sscanf(command, "+UDCONF=1,%d", &socket) == 1)
+    {
+        _hexMode = (socket == 1);
+    }
+    else if (strcmp(command, "+UDCONF=1") == 0)
+    {
+        output(_hexMode ? "\r\n+UDCONF: 1,1\r\n" : "\r\n+UDCONF: 1,0\r\n");
+    }
+    else if (sscanf(command, "+USODL=%d", &socket) == 1)
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+        _directLinkSocket = socket;
+        _escapeCount = 0;
+        output("\r\nCONNECT\r\n");
+        return SIM_RESULT_PROMPT; // No OK, the UART is now the socket
+    }
+    else if (sscanf(command, "+USOWR=%d,%u", &socket, &length) == 2)
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+        if (length == 0)
+            return SIM_CME_INVALID_PARAM;
+        _payloadSocket = socket;
+        _payloadSendTo = false;
+        _payloadLength = length;
+        _payloadRemaining = length;
+        output("\r\n@");
+        return SIM_RESULT_PROMPT;
+    }
+    else if (sscanf(command, "+USOST=%d,\"%15[^\"]\",%u,%u", &socket, _peerAddress, &_peerPort, &length) == 4)
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+        if (length == 0)
+            return SIM_CME_INVALID_PARAM;
+        _payloadSocket = socket;
+        _payloadSendTo = true;
+        _payloadLength = length;
+        _payloadRemaining = length;
+        output("\r\n@");
+        return SIM_RESULT_PROMPT;
+    }
+    else if (sscanf(command, "+USORD=%d,%u", &socket, &length) == 2)
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+        if (length == 0)
+        {
+            // Length 0 just asks how much is waiting
+            output("\r\n+USORD: ");
+            outputInt(socket);
+            output(',');
+            outputInt(_socketPending[socket]);
+            output("\r\n");
+            return SIM_RESULT_OK;
+        }
+        // Keep the reply within what the output buffer can hold
+        room = LTE_SHIELD_SIM_OUTPUT_SIZE - 1 - outputUsed();
+        room = (room > 40) ? room - 40 : 0;
+        if (length > _socketPending[socket])
+            length = _socketPending[socket];
+        if (_hexMode)
+            room /= 2;
+        if (length > room)
+            length = room;
+        output("\r\n+USORD: ");
+        outputInt(socket);
+        output(',');
+        outputSocketData(socket, length);
+        _socketPending[socket] -= length;
+    }
+    else if (sscanf(command, "+USORF=%d,%u", &socket, &length) == 2)
+    {
+        if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+            return SIM_CME_NOT_ALLOWED;
+        if (length == 0)
+        {
+            output("\r\n+USORF: ");
+            outputInt(socket);
+            output(',');
+            outputInt(_socketPending[socket]);
+            output("\r\n");
+            return SIM_RESULT_OK;
+        }
+        room = LTE_SHIELD_SIM_OUTPUT_SIZE - 1 - outputUsed();
+        room = (room > 60) ? room - 60 : 0;
+        if (length > _socketPending[socket])
+            length = _socketPending[socket];
+        if ((_datagramCount[socket] > 0) && (length > _datagrams[socket][0]))
+            length = _datagrams[socket][0];
+        if (_hexMode)
+            room /= 2;
+        datagramDone = (length <= room);
+        if (length > room)
+            length = room; // Our own limit, not the module's, so the rest of the datagram is kept
+        output("\r\n+USORF: ");
+        outputInt(socket);
+        output(",\"");
+        output(_peerAddress);
+        output("\",");
+        outputInt(_peerPort);
+        output(',');
+        outputSocketData(socket, length);
+        _socketPending[socket] -= length;
+        if (_datagramCount[socket] > 0)
+        {
+            _datagrams[socket][0] -= length;
+            if (datagramDone || (_datagrams[socket][0] == 0))
+            {
+                // Read, or cut short by the host's length: either way it's gone
+                _socketPending[socket] -= _datagrams[socket][0];
+                _socketOffset[socket] += _datagrams[socket][0];
+                _datagramCount[socket]--;
+                memmove(&_datagrams[socket][0], &_datagrams[socket][1],
+                        _datagramCount[socket] * sizeof(_datagrams[socket][0]));
+                if (_datagramCount[socket] > 0)
+                    announceSocketData(socket);
+            }
+        }
+    }
+    else if (strncmp(command, "+UDNSRN=0,\"", 11) == 0)
+    {
+        // Every name resolves to an address made from its characters, except the .invalid ones
+        char *host = command + 11;
+        char *end = strchr(host, '\"');
+        unsigned long hash = 0;
+
+        if ((end == NULL) || (end == host) ||
+            ((end - host >= 8) && (strncmp(end - 8, ".invalid", 8) == 0)))
+            return SIM_CME_DNS_FAILED;
+        for (char *c = host; c < end; c++)
+        {
+            hash = hash * 31 + (uint8_t)*c;
+        }
+        output("\r\n+UDNSRN: \"10.");
+        outputInt((hash >> 16) & 0xFF);
+        output('.');
+        outputInt((hash >> 8) & 0xFF);
+        output('.');
+        outputInt((hash & 0xFF) | 1);
+        output("\"\r\n");
+    }
+    else if (strncmp(command, "+CMGS=", 6) == 0)
+    {
+        _smsPayload = true;
+        output("\r\n> ");
+        return SIM_RESULT_PROMPT;
+    }
+    else if ((strchr(command, '?') != NULL) && (command[0] == '+'))
+    {
+        // Settings we don't model read back as their enabled value, e.g. "+CMEE: 1"
+        char *query = strchr(command, '?');
+        *query = '\0';
+        if (strcmp(command, "+UGPIOC") == 0)
+        {
+            output("\r\n+UGPIOC:\r\n16,2\r\n23,3\r\n");
+        }
+        else
+        {
+            output("\r\n");
+            output(command);
+            output(": 1\r\n");
+        }
+    }
+    // Anything else is a setting the simulator accepts without modelling
+    return SIM_RESULT_OK;
+}
+
+void LTE_Shield_Simulator::directLinkByte(uint8_t c)
+{
+    if (_loopback)
+    {
+        respond();
+        output((char)c);
+    }
+}
+
+void LTE_Shield_Simulator::checkEscape(void)
+{
+    // "+++" counts once the line has been quiet for the guard time after it
+    if ((_directLinkSocket < 0) || (_escapeCount < 3) || (millis() - _escapeTime < SIM_ESCAPE_GUARD))
+        return;
+    _directLinkSocket = -1;
+    _escapeCount = 0;
+    respond();
+    output("\r\nDISCONNECT\r\n");
+}
+
+void LTE_Shield_Simulator::outputSocketData(int socket, unsigned int length)
+{
+    // <length>,"<data>" from the socket's recognisable pattern
+    outputInt(length);
+    output(",\"");
+    for (unsigned int i = 0; i < length; i++)
+    {
+        char c = (char)('A' + (_socketOffset[socket]++ % 26));
+        if (_hexMode)
+        {
+            output(SIM_HEX_DIGITS[c >> 4]);
+            output(SIM_HEX_DIGITS[c & 0x0F]);
+        }
+        else
+        {
+            output(c);
+        }
+    }
+    output("\"\r\n");
+}
+
+void LTE_Shield_Simulator::announceSocketData(int socket)
+{
+    output(_socketUdp[socket] ? "\r\n+UUSORF: " : "\r\n+UUSORD: ");
+    outputInt(socket);
+    output(',');
+    outputInt((_datagramCount[socket] > 0) ? _datagrams[socket][0] : _socketPending[socket]);
+    output("\r\n");
+}
+
+boolean LTE_Shield_Simulator::queueDatagram(int socket, unsigned int length)
+{
+    if (_datagramCount[socket] == LTE_SHIELD_SIM_DATAGRAMS)
+    {
+        _datagrams[socket][LTE_SHIELD_SIM_DATAGRAMS - 1] += length;
+        return false;
+    }
+    _datagrams[socket][_datagramCount[socket]++] = length;
+    return (_datagramCount[socket] == 1);
+}
+
+void LTE_Shield_Simulator::checkConnects(void)
+{
+    if (_directLinkSocket >= 0)
+        return; // URCs wait until the UART is back in command mode
+
+    for (int socket = 0; socket < LTE_SHIELD_SIM_NUM_SOCKETS; socket++)
+    {
+        if (!_socketConnecting[socket] || ((long)(millis() - _connectDue[socket]) < 0))
+            continue;
+        _socketConnecting[socket] = false;
+        respond();
+        output("\r\n+UUSOCO: ");
+        outputInt(socket);
+        output(",0\r\n");
+    }
+}
+
+void LTE_Shield_Simulator::startHexPayload(void)
+{
+    int socket;
+    unsigned int length;
+    int end = 0;
+
+    // In hex mode +USOWR and +USOST carry their data on the command line, which may not fit
+    // in _line. Take over once the opening quote of AT+USOWR=<socket>,<length>,"<digits>" or
+    // AT+USOST=<socket>,"<address>",<port>,<length>,"<digits>" arrives.
+    _line[_lineLength] = '\0';
+    _payloadSendTo = false;
+    if ((sscanf(_line, "AT+USOWR=%d,%u,\"%n", &socket, &length, &end) != 2) || (end != _lineLength))
+    {
+        end = 0;
+        if ((sscanf(_line, "AT+USOST=%d,\"%15[^\"]\",%u,%u,\"%n", &socket, _peerAddress, &_peerPort, &length,
+                    &end) != 4) ||
+            (end != _lineLength))
+            return;
+        _payloadSendTo = true;
+    }
+
+    _commandsHandled++;
+    if ((socket < 0) || (socket >= LTE_SHIELD_SIM_NUM_SOCKETS) || !_socketOpen[socket])
+        socket = -1;
+    _payloadSocket = socket;
+    _payloadLength = length;
+    _payloadDigits = 0;
+    _hexPayload = true;
+    _lineLength = 0;
+}
+
+void LTE_Shield_Simulator::finishPayload(void)
+{
+    respond();
+    if (_smsPayload)
+    {
+        _smsPayload = false;
+        output("\r\n+CMGS: 1\r\n\r\nOK\r\n");
+        return;
+    }
+    if (_hexPayload)
+    {
+        _hexPayload = false;
+        if (_payloadSocket < 0)
+        {
+            output("\r\n+CME ERROR: ");
+            outputInt(SIM_CME_NOT_ALLOWED);
+            output("\r\n");
+            return;
+        }
+        if ((_payloadLength == 0) || (_payloadDigits != _payloadLength * 2))
+        {
+            output("\r\n+CME ERROR: ");
+            outputInt(SIM_CME_INVALID_PARAM);
+            output("\r\n");
+            _payloadSocket = -1;
+            return;
+        }
+    }
+
+    output(_payloadSendTo ? "\r\n+USOST: " : "\r\n+USOWR: ");
+    outputInt(_payloadSocket);
+    output(',');
+    outputInt(_payloadLength);
+    output("\r\n\r\nOK\r\n");
+    if (_loopback && (!_socketUdp[_payloadSocket] || queueDatagram(_payloadSocket, _payloadLength)))
+    {
+        announceSocketData(_payloadSocket);
+    }
+    _payloadSocket = -1;
+}
@@ -0,0 +1,145 @@
+/*
+  Simulated SARA-R410M for the SparkFun LTE Shield Arduino Library
+
+  A Stream that answers the AT commands the library sends the way a
+  SARA-R410M-02B would, with configurable response latency and byte rate.
+  Pass it to LTE_Shield::begin(Stream &) to exercise or benchmark the
+  library without a shield attached.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARKFUN_LTE_SHIELD_SIMULATOR_H
+#define SPARKFUN_LTE_SHIELD_SIMULATOR_H
+
+#if (ARDUINO >= 100)
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#ifndef LTE_SHIELD_SIM_OUTPUT_SIZE
+#define LTE_SHIELD_SIM_OUTPUT_SIZE 512 // Modem-to-host bytes not yet read by the library
+#endif
+#ifndef LTE_SHIELD_SIM_LINE_SIZE
+#define LTE_SHIELD_SIM_LINE_SIZE 160 // Longest command line accepted
+#endif
+#define LTE_SHIELD_SIM_NUM_SOCKETS 6
+#ifndef LTE_SHIELD_SIM_DATAGRAMS
+#define LTE_SHIELD_SIM_DATAGRAMS 4 // UDP datagrams waiting per socket, more are merged into the last
+#endif
+
+class LTE_Shield_Simulator : public Stream
+{
+public:
+    LTE_Shield_Simulator(void);
+
+    // Time from the end of a command line to the first byte of its response
+    void setLatency(unsigned long latency);
+    // Modem-to-host bytes per second, 0 for no limit. 11520 matches 115200 baud.
+    void setByteRate(unsigned long bytesPerSecond);
+    // Script a response. The handler gets each command line without "AT" and "\r",
+    // and returns the complete response text (including "\r\nOK\r\n"), or NULL
+    // to let the simulator answer as usual.
+    void setCommandHandler(const char *(*handler)(const char *command));
+    // How long a background connect (AT+USOCO=...,1) takes to report +UUSOCO
+    void setConnectTime(unsigned long connectTime);
+    // Written socket data is queued back for reading on the same socket
+    void setLoopback(boolean loopback);
+
+    // Queue readable data on a socket and announce it with +UUSORD. On a UDP socket it's one
+    // datagram, announced with +UUSORF once those ahead of it have been read. Like SARA-R4, a
+    // +USORF shorter than the datagram drops the rest of it.
+    void receiveSocketData(int socket, unsigned int length);
+    // Send an unsolicited result code, e.g. "+UUSOCL: 0"
+    void sendUrc(const char *urc);
+
+    unsigned long bytesFromHost(void);
+    unsigned long bytesToHost(void);
+    unsigned long commandsHandled(void);
+    unsigned long outputDropped(void); // Response bytes lost because the library wasn't reading
+
+    // Stream
+    virtual int available(void);
+    virtual int read(void);
+    virtual int peek(void);
+    virtual void flush(void);
+    virtual size_t write(uint8_t c);
+    using Print::write;
+
+private:
+    char _output[LTE_SHIELD_SIM_OUTPUT_SIZE];
+    unsigned int _outputHead;
+    unsigned int _outputTail;
+    unsigned long _outputDropped;
+
+    unsigned long _latency;
+    unsigned long _byteRate;
+    unsigned long _readyTime;   // millis() when the pending output starts to flow
+    unsigned long _readSinceReady;
+
+    char _line[LTE_SHIELD_SIM_LINE_SIZE];
+    uint8_t _lineLength;
+    boolean _echo;
+    boolean _loopback;
+    boolean _hexMode; // AT+UDCONF=1,1
+
+    // Payload following a '@' (+USOWR, +USOST) or '>' (+CMGS) prompt
+    int _payloadSocket;
+    boolean _payloadSendTo;       // +USOST, replied to as such
+    unsigned int _payloadRemaining;
+    unsigned int _payloadLength;
+    boolean _smsPayload;
+    boolean _hexPayload;          // Hex mode +USOWR, digits follow on the command line
+    unsigned int _payloadDigits;
+
+    // Direct link (+USODL), host bytes go to this socket until a "+++" escape
+    int _directLinkSocket;
+    uint8_t _escapeCount;         // '+'s seen after a guard time of silence
+    unsigned long _escapeTime;
+    unsigned long _lastHostByte;
+
+    boolean _socketOpen[LTE_SHIELD_SIM_NUM_SOCKETS];
+    boolean _socketUdp[LTE_SHIELD_SIM_NUM_SOCKETS];
+    unsigned int _socketPending[LTE_SHIELD_SIM_NUM_SOCKETS];
+    unsigned int _datagrams[LTE_SHIELD_SIM_NUM_SOCKETS][LTE_SHIELD_SIM_DATAGRAMS]; // Lengths, oldest first
+    uint8_t _datagramCount[LTE_SHIELD_SIM_NUM_SOCKETS];
+    unsigned long _socketOffset[LTE_SHIELD_SIM_NUM_SOCKETS]; // For a recognisable data pattern
+    boolean _socketConnecting[LTE_SHIELD_SIM_NUM_SOCKETS];
+    unsigned long _connectDue[LTE_SHIELD_SIM_NUM_SOCKETS];
+    unsigned long _connectTime;
+    char _peerAddress[16];        // Last +USOST destination, UDP data comes back from there
+    unsigned int _peerPort;
+
+    const char *(*_commandHandler)(const char *command);
+
+    unsigned long _bytesFromHost;
+    unsigned long _bytesToHost;
+    unsigned long _commandsHandled;
+
+    unsigned int outputUsed(void);
+    void output(const char *str);
+    void output(char c);
+    void outputInt(long value);
+    void respond(void);
+
+    void handleLine(void);
+    // Returns 0 if the command succeeded, a +CME ERROR code (or -1 for plain ERROR) if not
+    int handleCommand(char *command);
+    void startHexPayload(void);
+    void outputSocketData(int socket, unsigned int length);
+    void announceSocketData(int socket);
+    // Returns true if it's the only one waiting, and so should be announced now
+    boolean queueDatagram(int socket, unsigned int length);
+    void directLinkByte(uint8_t c);
+    void checkEscape(void);
+    void checkConnects(void);
+    void finishPayload(void);
+};
+
+#endif // SPARKFUN_LTE_SHIELD_SIMULATOR_H